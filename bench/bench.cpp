@@ -0,0 +1,113 @@
+/**
+ * Measures how the parallel search scales: the time taken and the number
+ * of positions visited to complete a fixed depth search of a set of
+ * positions, for increasing thread counts.
+ *
+ * Usage: DeepGreenBench [shared|split] [depth] [thread counts...]
+ *
+ * With DEEPGREEN_TRACE set to a file, a trace of the searches is written to it, see Trace.
+ * Built with DEEPGREEN_PERF_COUNTERS, the hardware performance counters of
+ * every thread count are reported by region, see PerfCounters.
+ */
+
+#include <QPromise>
+
+#include "../src/ai/brain.h"
+#include "../src/trace/trace.h"
+#include "../src/trace/perfcounters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char *positions[]{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+int main(int argc, char *argv[]) {
+    if (const char *tracePath = std::getenv("DEEPGREEN_TRACE"); tracePath && Trace::start(tracePath))
+        std::atexit([] { Trace::stop(); });
+
+    int arg = 1;
+
+    if (arg < argc && std::string(argv[arg]) == "split") {
+        Ai::setParallelMode(Ai::ParallelMode::SplitPoint);
+        ++arg;
+    } else if (arg < argc && std::string(argv[arg]) == "shared") {
+        ++arg;
+    }
+
+    const int depth = (arg < argc) ? std::atoi(argv[arg++]) : 7;
+
+    std::vector<int> threadCounts;
+    for (int i = arg; i < argc; ++i)
+        threadCounts.push_back(std::atoi(argv[i]));
+    if (threadCounts.empty())
+        threadCounts = {1, 2, 4, 8, 16};
+
+    std::cout << "Time to depth " << depth << " with "
+              << (Ai::parallelMode() == Ai::ParallelMode::SplitPoint ? "split points" : "shared hash") << '\n';
+
+    double baseline = 0;
+    uint64_t baselineNodes = 0;
+
+    for (const int threads: threadCounts) {
+        Ai::setThreadCount(threads);
+        PerfCounters::reset();
+
+        std::chrono::duration<double, std::milli> total{0};
+        uint64_t nodes = 0;
+        Ai::EvaluationCacheStats evaluations;
+
+        for (const auto *fen: positions) {
+            const Chess::Board board{std::string(fen)};
+
+            // Every search starts from an empty table, so runs do not help each other
+            Ai::clearHash();
+
+            QPromise<Chess::Move> promise;
+            promise.start();
+
+            const auto start = std::chrono::steady_clock::now();
+            Ai::selectMoveToDepth(promise, board, depth);
+            total += std::chrono::steady_clock::now() - start;
+            nodes += Ai::nodeCount();
+
+            const auto stats = Ai::evaluationCacheStats();
+            evaluations.hits += stats.hits;
+            evaluations.misses += stats.misses;
+
+            promise.finish();
+        }
+
+        if (baseline == 0) {
+            baseline = total.count();
+            baselineNodes = nodes;
+        }
+
+        // Node efficiency is how much of the extra work done by more threads is useful
+        std::cout << std::setw(3) << threads << " threads: "
+                  << std::setw(10) << std::fixed << std::setprecision(1) << total.count() << " ms, speedup "
+                  << std::setprecision(2) << baseline / total.count() << ", "
+                  << std::setw(12) << nodes << " nodes, node efficiency "
+                  << static_cast<double>(baselineNodes) / static_cast<double>(nodes) << ", evaluation cache hits "
+                  << std::setprecision(1)
+                  << 100.0 * static_cast<double>(evaluations.hits) /
+                     static_cast<double>(std::max<uint64_t>(evaluations.hits + evaluations.misses, 1)) << "%\n";
+
+        if constexpr (PerfCounters::isEnabled)
+            PerfCounters::report(std::cout);
+    }
+
+    return 0;
+}
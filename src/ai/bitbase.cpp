@@ -0,0 +1,711 @@
+#include "bitbase.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <tuple>
+
+namespace Ai::Bitbases {
+
+    using Chess::Bitboard;
+    using Chess::Board;
+    using Chess::Color;
+    using Chess::Direction;
+    using Chess::PieceType;
+    using Chess::Square;
+
+    static constexpr uint32_t fileVersion = 1;
+
+    /**
+     * Letters of the pieces other than kings, from the strongest to the weakest,
+     * in the order of the PieceType enum
+     */
+    static constexpr char pieceLetters[] = "QRBNP";
+
+    struct Piece {
+        Color color;
+        PieceType type;
+        Square square;
+    };
+
+    /**
+     * A position of an endgame. The pieces are sorted: the white king, the
+     * black king, then the other white pieces and the other black pieces,
+     * each from queen to pawn.
+     */
+    struct Position {
+        std::array<Piece, maxPieces> pieces;
+        int count{0};
+        Color turn{Color::White};
+    };
+
+    static void sortPieces(Position &position) {
+        std::sort(position.pieces.begin(), position.pieces.begin() + position.count, [](const auto &a, const auto &b) {
+            const auto key = [](const Piece &piece) {
+                return std::tuple(piece.type != PieceType::King, piece.color, piece.type);
+            };
+            return key(a) < key(b);
+        });
+    }
+
+    /**
+     * The letters of the pieces of one side other than the king, from queen to pawn.
+     */
+    static std::string sideName(const Position &position, Color color) {
+        std::string name;
+        for (int i = 2; i < position.count; ++i) {
+            if (position.pieces[i].color == color)
+                name += pieceLetters[static_cast<int>(position.pieces[i].type) - 1];
+        }
+        return name;
+    }
+
+    /**
+     * Whether one side has more pieces than the other, or as many but stronger ones.
+     */
+    static bool isStronger(const std::string &side, const std::string &otherSide) {
+        if (side.size() != otherSide.size())
+            return side.size() > otherSide.size();
+
+        for (std::size_t i = 0; i < side.size(); ++i) {
+            const auto strength = std::strchr(pieceLetters, side[i]);
+            const auto otherStrength = std::strchr(pieceLetters, otherSide[i]);
+            if (strength != otherStrength)
+                return strength < otherStrength;
+        }
+        return false;
+    }
+
+    std::string canonicalName(const std::string &name) {
+        const auto secondKing = name.find('K', 1);
+        if (name.empty() || name[0] != 'K' || secondKing == std::string::npos ||
+            name.size() > static_cast<std::size_t>(maxPieces))
+            return {};
+
+        auto white = name.substr(1, secondKing - 1);
+        auto black = name.substr(secondKing + 1);
+
+        for (auto *side: {&white, &black}) {
+            for (const char letter: *side) {
+                if (!std::strchr(pieceLetters, letter) || letter == '\0')
+                    return {};
+            }
+            std::sort(side->begin(), side->end(), [](char a, char b) {
+                return std::strchr(pieceLetters, a) < std::strchr(pieceLetters, b);
+            });
+        }
+
+        if (isStronger(black, white))
+            std::swap(white, black);
+
+        return "K" + white + "K" + black;
+    }
+
+    static Square mirrorFile(Square square) {
+        return Square(static_cast<int>(square) ^ 7);
+    }
+
+    static Square mirrorRank(Square square) {
+        return Square(static_cast<int>(square) ^ 56);
+    }
+
+    static Square flipDiagonal(Square square) {
+        const int index = static_cast<int>(square);
+        return Square((index >> 3) | ((index & 7) << 3));
+    }
+
+    /**
+     * Index of each square of the a1-d1-d4 triangle, or -1 for other squares
+     */
+    static constexpr auto triangleIndices = [] {
+        std::array<int, 64> indices{};
+        int next = 0;
+        for (int square = 0; square < 64; ++square) {
+            const int file = square % 8;
+            const int rank = square / 8;
+            indices[square] = (file <= 3 && rank <= file) ? next++ : -1;
+        }
+        return indices;
+    }();
+
+    /**
+     * The bitbase of one endgame.
+     */
+    class Table {
+    public:
+        explicit Table(const std::string &name)
+                : name(name) {
+            const auto secondKing = name.find('K', 1);
+
+            layout.push_back({Color::White, PieceType::King, Square::None});
+            layout.push_back({Color::Black, PieceType::King, Square::None});
+            for (std::size_t i = 1; i < name.size(); ++i) {
+                if (i == secondKing)
+                    continue;
+                const auto color = (i < secondKing) ? Color::White : Color::Black;
+                const auto type = PieceType(std::strchr(pieceLetters, name[i]) - pieceLetters + 1);
+                layout.push_back({color, type, Square::None});
+                hasPawns |= type == PieceType::Pawn;
+            }
+
+            kingSquares = hasPawns ? 32 : 10;
+            size = 2 * kingSquares * 64;
+            for (std::size_t i = 2; i < layout.size(); ++i)
+                size *= squareCount(layout[i].type);
+
+            data.resize((size + 3) / 4);
+        }
+
+        const std::string name;
+
+        /**
+         * The pieces of the endgame, sorted like those of a Position
+         */
+        std::vector<Piece> layout;
+
+        bool hasPawns{false};
+
+        /**
+         * Squares the white king can be on after folding away the symmetries
+         */
+        int kingSquares;
+
+        /**
+         * Number of positions
+         */
+        std::size_t size;
+
+        /**
+         * The result of each position, 2 bits each
+         */
+        std::vector<uint8_t> data;
+
+        [[nodiscard]]
+        std::size_t index(const Position &position) const {
+            std::array<Square, maxPieces> squares{};
+            for (int i = 0; i < position.count; ++i)
+                squares[i] = position.pieces[i].square;
+
+            const auto transform = [&](Square (*function)(Square)) {
+                for (int i = 0; i < position.count; ++i)
+                    squares[i] = function(squares[i]);
+            };
+
+            if (static_cast<int>(squares[0]) % 8 > 3)
+                transform(mirrorFile);
+            if (!hasPawns) {
+                if (static_cast<int>(squares[0]) / 8 > 3)
+                    transform(mirrorRank);
+                if (static_cast<int>(squares[0]) / 8 > static_cast<int>(squares[0]) % 8)
+                    transform(flipDiagonal);
+            }
+
+            const int king = static_cast<int>(squares[0]);
+            std::size_t result = hasPawns ? (king / 8) * 4 + king % 8 : triangleIndices[king];
+            result = result * 64 + static_cast<int>(squares[1]);
+            for (int i = 2; i < position.count; ++i) {
+                const int square = static_cast<int>(squares[i]);
+                result = result * squareCount(layout[i].type) +
+                         ((layout[i].type == PieceType::Pawn) ? square - 8 : square);
+            }
+            return result * 2 + static_cast<int>(position.turn);
+        }
+
+        [[nodiscard]]
+        Position position(std::size_t index) const {
+            Position result;
+            result.count = static_cast<int>(layout.size());
+            result.turn = Color(index % 2);
+            index /= 2;
+
+            for (int i = result.count - 1; i >= 2; --i) {
+                const auto range = squareCount(layout[i].type);
+                const int square = static_cast<int>(index % range);
+                index /= range;
+                result.pieces[i] = {layout[i].color, layout[i].type,
+                                    Square((layout[i].type == PieceType::Pawn) ? square + 8 : square)};
+            }
+
+            result.pieces[1] = {Color::Black, PieceType::King, Square(index % 64)};
+            index /= 64;
+
+            int king = 0;
+            if (hasPawns) {
+                king = static_cast<int>(index / 4) * 8 + static_cast<int>(index % 4);
+            } else {
+                while (triangleIndices[king] != static_cast<int>(index))
+                    ++king;
+            }
+            result.pieces[0] = {Color::White, PieceType::King, Square(king)};
+
+            return result;
+        }
+
+        [[nodiscard]]
+        Result result(std::size_t index) const {
+            return Result((this->data[index / 4] >> (2 * (index % 4))) & 3);
+        }
+
+        void setResult(std::size_t index, Result result) {
+            this->data[index / 4] |= static_cast<uint8_t>(static_cast<int>(result) << (2 * (index % 4)));
+        }
+
+    private:
+        /**
+         * Pawns can only stand on the 48 squares between the first and last rank
+         */
+        static std::size_t squareCount(PieceType type) {
+            return (type == PieceType::Pawn) ? 48 : 64;
+        }
+    };
+
+    static std::map<std::string, std::unique_ptr<Table>> tables;
+
+    static Position flipColors(const Position &position) {
+        Position result = position;
+        for (int i = 0; i < result.count; ++i) {
+            auto &piece = result.pieces[i];
+            piece.color = Chess::oppositeTeam(piece.color);
+            piece.square = mirrorRank(piece.square);
+        }
+        result.turn = Chess::oppositeTeam(result.turn);
+        sortPieces(result);
+        return result;
+    }
+
+    /**
+     * Look up a position in the bitbase of its material, with the colors
+     * swapped if the bitbase has the stronger side the other way around.
+     */
+    static std::optional<Result> probe(const Position &position) {
+        if (position.count == 2)
+            return Result::Draw;
+
+        const auto white = sideName(position, Color::White);
+        const auto black = sideName(position, Color::Black);
+
+        const bool isFlipped = isStronger(black, white);
+        const auto table = tables.find(isFlipped ? "K" + black + "K" + white : "K" + white + "K" + black);
+        if (table == tables.end())
+            return std::nullopt;
+
+        return table->second->result(table->second->index(isFlipped ? flipColors(position) : position));
+    }
+
+    static Bitboard pawnCaptures(Color color, Square square) {
+        const Bitboard pawn(square);
+        return (color == Color::White)
+               ? pawn.shifted<Direction::NorthEast>() | pawn.shifted<Direction::NorthWest>()
+               : pawn.shifted<Direction::SouthEast>() | pawn.shifted<Direction::SouthWest>();
+    }
+
+    std::optional<Result> probe(const Chess::Board &board) {
+        if (tables.empty())
+            return std::nullopt;
+
+        const auto occupied = board.teamOccupiedSquares(Color::White) | board.teamOccupiedSquares(Color::Black);
+        if (occupied.populationCount() > maxPieces || board.castlingMask() != 0)
+            return std::nullopt;
+
+        // Positions where an en passant capture is possible are not stored
+        const auto enPassant = board.enPassantSquare();
+        if (enPassant != Square::None &&
+            (pawnCaptures(oppositeTeam(board.turnToMove()), enPassant) &
+             board.pieces(board.turnToMove(), PieceType::Pawn)))
+            return std::nullopt;
+
+        Position position;
+        for (const auto color: {Color::White, Color::Black}) {
+            for (int type = 0; type < 6; ++type) {
+                for (auto pieces = board.pieces(color, PieceType(type)); pieces;)
+                    position.pieces[position.count++] = {color, PieceType(type), pieces.popLowestSquare()};
+            }
+        }
+        position.turn = board.turnToMove();
+        sortPieces(position);
+
+        return probe(position);
+    }
+
+    /**
+     * Computes a bitbase by repeatedly going through every position whose
+     * result is not yet known, deciding it from the results of the positions
+     * its moves lead to: a position is won if some move leads to a lost
+     * position, and lost if all moves lead to won positions. Starting from
+     * the checkmates, every pass settles the positions one move further from
+     * the end, until a pass settles nothing and the rest are draws. The
+     * threads take part in every pass, each going through its own share of
+     * the positions.
+     * See https://www.chessprogramming.org/Retrograde_Analysis
+     */
+    class Generator {
+    public:
+        explicit Generator(Table &table)
+                : table(table),
+                  states(table.size) {}
+
+        void run(int threadCount) {
+            bool isFirstPass = true;
+            do {
+                this->changed = false;
+
+                std::vector<std::thread> threads;
+                for (int i = 0; i < threadCount; ++i)
+                    threads.emplace_back(&Generator::pass, this, i, threadCount, isFirstPass);
+                for (auto &thread: threads)
+                    thread.join();
+
+                isFirstPass = false;
+            } while (this->changed);
+
+            for (std::size_t i = 0; i < this->table.size; ++i) {
+                const auto state = State(this->states[i].load(std::memory_order_relaxed));
+                if (state == State::Win)
+                    this->table.setResult(i, Result::Win);
+                else if (state == State::Loss)
+                    this->table.setResult(i, Result::Loss);
+            }
+        }
+
+    private:
+        enum class State : uint8_t {
+            Unknown,
+            Win,
+            Loss,
+            Draw,
+            Invalid,
+        };
+
+        static constexpr std::size_t chunkSize = 4096;
+
+        Table &table;
+
+        /**
+         * The state of each position of the table. Threads read the states of
+         * positions which other threads are deciding, but a state only ever
+         * goes from unknown to a final result, so either value is correct.
+         */
+        std::vector<std::atomic<uint8_t>> states;
+
+        std::atomic<bool> changed{false};
+
+        void pass(int thread, int threadCount, bool isFirstPass) {
+            bool hasChanged = false;
+
+            for (auto begin = thread * chunkSize; begin < this->table.size; begin += threadCount * chunkSize) {
+                const auto end = std::min(begin + chunkSize, this->table.size);
+                for (auto i = begin; i < end; ++i) {
+                    if (State(this->states[i].load(std::memory_order_relaxed)) != State::Unknown)
+                        continue;
+
+                    const auto position = this->table.position(i);
+
+                    auto state = State::Unknown;
+                    if (isFirstPass && !isValid(position))
+                        state = State::Invalid;
+                    else
+                        state = evaluate(position, Square::None);
+
+                    if (state != State::Unknown) {
+                        this->states[i].store(static_cast<uint8_t>(state), std::memory_order_relaxed);
+                        hasChanged = true;
+                    }
+                }
+            }
+
+            if (hasChanged)
+                this->changed = true;
+        }
+
+        static Bitboard occupiedSquares(const Position &position) {
+            Bitboard occupied;
+            for (int i = 0; i < position.count; ++i)
+                occupied.setOccupancyAt(position.pieces[i].square);
+            return occupied;
+        }
+
+        static Bitboard attacks(const Piece &piece, Bitboard occupied) {
+            switch (piece.type) {
+                case PieceType::King:
+                    return Board::kingAttacks(piece.square);
+                case PieceType::Queen:
+                    return Board::queenAttacks(piece.square, occupied);
+                case PieceType::Rook:
+                    return Board::rookAttacks(piece.square, occupied);
+                case PieceType::Bishop:
+                    return Board::bishopAttacks(piece.square, occupied);
+                case PieceType::Knight:
+                    return Board::knightAttacks(piece.square);
+                case PieceType::Pawn:
+                    return pawnCaptures(piece.color, piece.square);
+            }
+            return {};
+        }
+
+        static bool isAttacked(const Position &position, Square square, Color color) {
+            const auto occupied = occupiedSquares(position);
+            for (int i = 0; i < position.count; ++i) {
+                const auto &piece = position.pieces[i];
+                if (piece.color == color && attacks(piece, occupied).isOccupiedAt(square))
+                    return true;
+            }
+            return false;
+        }
+
+        static Square kingSquare(const Position &position, Color color) {
+            return position.pieces[(color == Color::White) ? 0 : 1].square;
+        }
+
+        static bool isValid(const Position &position) {
+            if (occupiedSquares(position).populationCount() != position.count)
+                return false;
+
+            // The side which just moved cannot have left its king in check
+            const auto opponent = Chess::oppositeTeam(position.turn);
+            return !isAttacked(position, kingSquare(position, opponent), position.turn);
+        }
+
+        /**
+         * The state of a position after a move, from the point of view of the opponent
+         */
+        State stateAfter(const Position &child, bool isSameMaterial, Square enPassant) {
+            if (!isSameMaterial) {
+                // Other endgames are finished before this one
+                const auto result = probe(child);
+                return (result == Result::Win) ? State::Win : (result == Result::Loss) ? State::Loss : State::Draw;
+            }
+
+            // The table does not hold positions with an en passant square, so look one move further
+            if (enPassant != Square::None)
+                return evaluate(child, enPassant);
+
+            return State(this->states[this->table.index(child)].load(std::memory_order_relaxed));
+        }
+
+        /**
+         * Decide a position from the states of the positions its moves lead
+         * to, as far as they are known.
+         */
+        State evaluate(const Position &position, Square enPassant) {
+            const auto us = position.turn;
+            const auto them = Chess::oppositeTeam(us);
+            const auto occupied = occupiedSquares(position);
+
+            Bitboard own;
+            for (int i = 0; i < position.count; ++i) {
+                if (position.pieces[i].color == us)
+                    own.setOccupancyAt(position.pieces[i].square);
+            }
+            const auto enemy = occupied & ~own;
+
+            bool hasMoves = false;
+            bool isAllWon = true;
+            bool isAllKnown = true;
+
+            // Returns true if the move wins
+            const auto tryMove = [&](int pieceIndex, Square to, Square captureSquare, Square childEnPassant) {
+                Position child = position;
+                child.turn = them;
+                child.pieces[pieceIndex].square = to;
+
+                bool isSameMaterial = true;
+                if (captureSquare != Square::None) {
+                    const auto captured = std::find_if(child.pieces.begin(), child.pieces.begin() + child.count,
+                                                       [&](const Piece &piece) {
+                                                           return piece.color == them && piece.square == captureSquare;
+                                                       });
+                    std::copy(captured + 1, child.pieces.begin() + child.count, captured);
+                    --child.count;
+                    isSameMaterial = false;
+                }
+
+                auto &moved = *std::find_if(child.pieces.begin(), child.pieces.begin() + child.count,
+                                            [&](const Piece &piece) { return piece.color == us && piece.square == to; });
+                if (moved.type == PieceType::Pawn && (static_cast<int>(to) / 8 == 0 || static_cast<int>(to) / 8 == 7)) {
+                    moved.type = PieceType::Queen;
+                    isSameMaterial = false;
+                }
+                sortPieces(child);
+
+                if (isAttacked(child, kingSquare(child, us), them))
+                    return false;
+
+                hasMoves = true;
+
+                const auto state = stateAfter(child, isSameMaterial, childEnPassant);
+                if (state == State::Loss)
+                    return true;
+                if (state != State::Win)
+                    isAllWon = false;
+                if (state == State::Unknown)
+                    isAllKnown = false;
+                return false;
+            };
+
+            for (int i = 0; i < position.count; ++i) {
+                const auto &piece = position.pieces[i];
+                if (piece.color != us)
+                    continue;
+
+                if (piece.type == PieceType::Pawn) {
+                    const int forward = (us == Color::White) ? 8 : -8;
+                    const auto from = static_cast<int>(piece.square);
+                    const auto single = Square(from + forward);
+
+                    if (!occupied.isOccupiedAt(single)) {
+                        if (tryMove(i, single, Square::None, Square::None))
+                            return State::Win;
+
+                        const int startRank = (us == Color::White) ? 1 : 6;
+                        const auto twice = Square(from + 2 * forward);
+                        if (from / 8 == startRank && !occupied.isOccupiedAt(twice)) {
+                            // Only worth an en passant square if an enemy pawn can capture on it
+                            bool canBeCaptured = false;
+                            for (int j = 0; j < position.count; ++j) {
+                                const auto &other = position.pieces[j];
+                                if (other.color == them && other.type == PieceType::Pawn &&
+                                    pawnCaptures(them, other.square).isOccupiedAt(single))
+                                    canBeCaptured = true;
+                            }
+                            if (tryMove(i, twice, Square::None, canBeCaptured ? single : Square::None))
+                                return State::Win;
+                        }
+                    }
+
+                    for (auto targets = pawnCaptures(us, piece.square) & enemy; targets;) {
+                        const auto to = targets.popLowestSquare();
+                        if (tryMove(i, to, to, Square::None))
+                            return State::Win;
+                    }
+
+                    if (enPassant != Square::None && pawnCaptures(us, piece.square).isOccupiedAt(enPassant)) {
+                        const auto captureSquare = Square(static_cast<int>(enPassant) - forward);
+                        if (tryMove(i, enPassant, captureSquare, Square::None))
+                            return State::Win;
+                    }
+                    continue;
+                }
+
+                for (auto targets = attacks(piece, occupied) & ~own; targets;) {
+                    const auto to = targets.popLowestSquare();
+                    if (tryMove(i, to, enemy.isOccupiedAt(to) ? to : Square::None, Square::None))
+                        return State::Win;
+                }
+            }
+
+            if (!hasMoves)
+                return isAttacked(position, kingSquare(position, us), them) ? State::Loss : State::Draw;
+            if (isAllWon)
+                return State::Loss;
+            return isAllKnown ? State::Draw : State::Unknown;
+        }
+    };
+
+    bool generate(const std::string &name, int threads) {
+        const auto canonical = canonicalName(name);
+        if (canonical.empty())
+            return false;
+        if (canonical.size() == 2 || tables.contains(canonical))
+            return true;
+
+        auto table = std::make_unique<Table>(canonical);
+
+        // Endgames this one turns into by a capture or a promotion come first
+        const auto &layout = table->layout;
+        for (std::size_t i = 2; i < layout.size(); ++i) {
+            Position position;
+            for (const auto &piece: layout)
+                position.pieces[position.count++] = piece;
+
+            auto captured = position;
+            std::copy(captured.pieces.begin() + i + 1, captured.pieces.begin() + captured.count,
+                      captured.pieces.begin() + i);
+            --captured.count;
+            if (!generate("K" + sideName(captured, Color::White) + "K" + sideName(captured, Color::Black), threads))
+                return false;
+
+            if (layout[i].type == PieceType::Pawn) {
+                auto promoted = position;
+                promoted.pieces[i].type = PieceType::Queen;
+                sortPieces(promoted);
+                if (!generate("K" + sideName(promoted, Color::White) + "K" + sideName(promoted, Color::Black),
+                              threads))
+                    return false;
+            }
+        }
+
+        if (threads <= 0)
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+        Generator(*table).run(threads);
+        tables.emplace(canonical, std::move(table));
+        return true;
+    }
+
+    bool save(const std::string &name, const std::string &directory) {
+        const auto table = tables.find(canonicalName(name));
+        if (table == tables.end())
+            return false;
+
+        const auto path = std::filesystem::path(directory) / (table->first + ".bitbase");
+        std::ofstream file(path, std::ios::binary);
+
+        const uint64_t size = table->second->size;
+        file.write("DGBB", 4);
+        file.write(reinterpret_cast<const char *>(&fileVersion), sizeof(fileVersion));
+        file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char *>(table->second->data.data()),
+                   static_cast<std::streamsize>(table->second->data.size()));
+
+        return static_cast<bool>(file);
+    }
+
+    int load(const std::string &directory) {
+        std::error_code error;
+        int loaded = 0;
+
+        for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+            if (entry.path().extension() != ".bitbase")
+                continue;
+
+            const auto name = entry.path().stem().string();
+            if (canonicalName(name) != name || name.size() == 2)
+                continue;
+
+            std::ifstream file(entry.path(), std::ios::binary);
+
+            char magic[4];
+            uint32_t version = 0;
+            uint64_t size = 0;
+            file.read(magic, 4);
+            file.read(reinterpret_cast<char *>(&version), sizeof(version));
+            file.read(reinterpret_cast<char *>(&size), sizeof(size));
+
+            auto table = std::make_unique<Table>(name);
+            if (!file || std::memcmp(magic, "DGBB", 4) != 0 || version != fileVersion || size != table->size)
+                continue;
+
+            file.read(reinterpret_cast<char *>(table->data.data()), static_cast<std::streamsize>(table->data.size()));
+            if (!file)
+                continue;
+
+            tables[name] = std::move(table);
+            ++loaded;
+        }
+
+        return loaded;
+    }
+
+    std::vector<std::string> available() {
+        std::vector<std::string> names;
+        for (const auto &[name, table]: tables)
+            names.push_back(name);
+        return names;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../chess/board.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Win/draw/loss bitbases for endgames with few pieces, computed by
+ * retrograde analysis. Each endgame, named by its material with the
+ * stronger side first (e.g. "KPK" or "KQKR"), is stored with 2 bits per
+ * position, indexed by the squares of its pieces and the side to move, with
+ * the symmetries of the board folded away: the white king is kept on the
+ * left half of the board, and without pawns also below the diagonal and on
+ * the lower half.
+ *
+ * <p> The results follow the rules of the engine, which always promotes to a
+ * queen, and assume no castling rights. Positions where an en passant
+ * capture is possible are not probed.
+ * See https://www.chessprogramming.org/Retrograde_Analysis
+ */
+namespace Ai::Bitbases {
+
+    inline constexpr int maxPieces = 4;
+
+    /**
+     * The result of a position with perfect play, for the side to move.
+     */
+    enum class Result : uint8_t {
+        Draw,
+        Win,
+        Loss,
+    };
+
+    /**
+     * The canonical name of an endgame, with the stronger side first and the
+     * pieces of each side from queen to pawn, or an empty string if the
+     * material is not a valid endgame of at most maxPieces pieces.
+     */
+    [[nodiscard]]
+    std::string canonicalName(const std::string &name);
+
+    /**
+     * Generate the bitbase of an endgame in memory, together with those of
+     * the endgames it can turn into by captures and promotions, using the
+     * given number of threads. Bitbases which are already present are kept.
+     * Must not be called while a search is running.
+     */
+    bool generate(const std::string &name, int threads);
+
+    /**
+     * Write a bitbase generated or loaded before to the file <name>.bitbase in a directory.
+     */
+    bool save(const std::string &name, const std::string &directory);
+
+    /**
+     * Load every bitbase file in a directory, returning how many were loaded.
+     * Must not be called while a search is running.
+     */
+    int load(const std::string &directory);
+
+    /**
+     * Names of the bitbases present.
+     */
+    [[nodiscard]]
+    std::vector<std::string> available();
+
+    /**
+     * Look up a position, which succeeds if it has at most maxPieces pieces
+     * and the bitbase of its material is present.
+     */
+    [[nodiscard]]
+    std::optional<Result> probe(const Chess::Board &board);
+}
@@ -0,0 +1,208 @@
+#include "book.h"
+#include "polyglot.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Ai {
+
+    using Chess::Bitboard;
+    using Chess::Color;
+    using Chess::Direction;
+    using Chess::PieceType;
+    using Chess::Square;
+
+    namespace Polyglot {
+
+        /**
+         * Offsets of the castling, en passant and side to move numbers in the
+         * random table; the piece numbers come first.
+         */
+        static constexpr int castlingOffset = 768;
+        static constexpr int enPassantOffset = 772;
+        static constexpr int turnOffset = 780;
+
+        uint64_t hash(const Chess::Board &board) {
+            uint64_t result = 0;
+
+            for (const auto color: {Color::White, Color::Black}) {
+                for (int piece = 0; piece < 6; ++piece) {
+                    // Polyglot orders the pieces from pawn to king, black before white
+                    const int kind = 2 * (5 - piece) + (color == Color::White ? 1 : 0);
+                    for (auto pieces = board.pieces(color, PieceType(piece)); pieces;)
+                        result ^= randomTable[64 * kind + static_cast<int>(pieces.popLowestSquare())];
+                }
+            }
+
+            const int castling = board.castlingMask();
+            for (int i = 0; i < 4; ++i) {
+                if (castling & (1 << i))
+                    result ^= randomTable[castlingOffset + i];
+            }
+
+            // The en passant square only counts if a pawn can actually capture on it
+            if (const auto enPassant = board.enPassantSquare(); enPassant != Square::None) {
+                const Bitboard target(enPassant);
+                const auto us = board.turnToMove();
+                const Bitboard attackers = (us == Color::White)
+                                           ? target.shifted<Direction::SouthEast>() |
+                                             target.shifted<Direction::SouthWest>()
+                                           : target.shifted<Direction::NorthEast>() |
+                                             target.shifted<Direction::NorthWest>();
+                if (attackers & board.pieces(us, PieceType::Pawn))
+                    result ^= randomTable[enPassantOffset + static_cast<int>(enPassant) % 8];
+            }
+
+            if (board.turnToMove() == Color::White)
+                result ^= randomTable[turnOffset];
+
+            return result;
+        }
+
+        /**
+         * Moves are stored as their origin and target squares and the
+         * promotion piece, where castling is the king capturing its own rook.
+         */
+        static uint16_t encodeMove(const Chess::Move &move) {
+            auto to = move.to;
+            switch (move.castle) {
+                case Chess::Castling::WhiteKing:
+                    to = Square::H1;
+                    break;
+                case Chess::Castling::WhiteQueen:
+                    to = Square::A1;
+                    break;
+                case Chess::Castling::BlackKing:
+                    to = Square::H8;
+                    break;
+                case Chess::Castling::BlackQueen:
+                    to = Square::A8;
+                    break;
+                case Chess::Castling::None:
+                    break;
+            }
+
+            // Pawns always promote to queens
+            const int promotion = move.promotion ? 4 : 0;
+            return static_cast<uint16_t>(static_cast<int>(to) | static_cast<int>(move.from) << 6 | promotion << 12);
+        }
+    }
+
+    /**
+     * Entries consist of the hash, the move, the weight and learning data,
+     * all big endian.
+     */
+    static constexpr std::size_t entrySize = 16;
+
+    template<typename T>
+    static T readBigEndian(const uchar *data) {
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            value = static_cast<T>(value << 8 | data[i]);
+        return value;
+    }
+
+    bool OpeningBook::open(const std::string &path) {
+        close();
+
+        this->file.setFileName(QString::fromStdString(path));
+        if (!this->file.open(QIODevice::ReadOnly))
+            return false;
+
+        const auto size = this->file.size();
+        if (size == 0 || size % entrySize != 0) {
+            this->file.close();
+            return false;
+        }
+
+        this->entries = this->file.map(0, size);
+        if (!this->entries) {
+            this->file.close();
+            return false;
+        }
+
+        this->entryCount = static_cast<std::size_t>(size) / entrySize;
+        return true;
+    }
+
+    void OpeningBook::close() {
+        if (this->entries)
+            this->file.unmap(this->entries);
+        this->entries = nullptr;
+        this->entryCount = 0;
+
+        if (this->file.isOpen())
+            this->file.close();
+    }
+
+    bool OpeningBook::isOpen() const {
+        return this->entries != nullptr;
+    }
+
+    std::vector<BookMove> OpeningBook::moves(const Chess::Board &board) const {
+        std::vector<BookMove> result;
+        if (!isOpen())
+            return result;
+
+        const auto key = Polyglot::hash(board);
+
+        // Binary search for the first entry of the position
+        std::size_t low = 0;
+        std::size_t high = this->entryCount;
+        while (low < high) {
+            const auto middle = low + (high - low) / 2;
+            if (readBigEndian<uint64_t>(this->entries + middle * entrySize) < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        auto position = board;
+        const auto legalMoves = position.legalMoves();
+
+        for (auto i = low; i < this->entryCount; ++i) {
+            const auto *entry = this->entries + i * entrySize;
+            if (readBigEndian<uint64_t>(entry) != key)
+                break;
+
+            const auto move = readBigEndian<uint16_t>(entry + 8);
+            const auto weight = readBigEndian<uint16_t>(entry + 10);
+
+            // Entries are only trusted as far as they match a legal move
+            const auto legalMove = std::find_if(legalMoves.begin(), legalMoves.end(), [move](const auto &legal) {
+                return Polyglot::encodeMove(legal) == move;
+            });
+            if (legalMove != legalMoves.end())
+                result.push_back({*legalMove, weight});
+        }
+
+        return result;
+    }
+
+    std::optional<Chess::Move> OpeningBook::selectMove(const Chess::Board &board, BookSelection selection) {
+        const auto bookMoves = moves(board);
+
+        // Moves of weight 0 are in the book to be avoided
+        const uint32_t totalWeight = std::accumulate(bookMoves.begin(), bookMoves.end(), 0u,
+                                                     [](uint32_t sum, const BookMove &bookMove) {
+                                                         return sum + bookMove.weight;
+                                                     });
+        if (totalWeight == 0)
+            return std::nullopt;
+
+        if (selection == BookSelection::Best) {
+            return std::max_element(bookMoves.begin(), bookMoves.end(), [](const auto &a, const auto &b) {
+                return a.weight < b.weight;
+            })->move;
+        }
+
+        auto pick = std::uniform_int_distribution<uint32_t>(0, totalWeight - 1)(this->random);
+        for (const auto &bookMove: bookMoves) {
+            if (pick < bookMove.weight)
+                return bookMove.move;
+            pick -= bookMove.weight;
+        }
+
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QFile>
+
+#include "../chess/board.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Ai {
+
+    /**
+     * How a move is picked among the book moves of a position.
+     */
+    enum class BookSelection {
+        /**
+         * At random, in proportion to the weights of the moves
+         */
+        Weighted,
+
+        /**
+         * Always the move with the highest weight
+         */
+        Best,
+    };
+
+    /**
+     * A move found in the opening book.
+     */
+    struct BookMove {
+        Chess::Move move;
+        uint16_t weight;
+    };
+
+    /**
+     * Opening book in the Polyglot format: a file of 16-byte entries, sorted
+     * by the Polyglot hash of the position, each holding a move and its
+     * weight. The file is mapped into memory and searched in place, so
+     * opening even a large book is instant.
+     * See http://hgm.nubati.net/book_format.html
+     */
+    class OpeningBook {
+    public:
+        OpeningBook() = default;
+
+        OpeningBook(const OpeningBook &) = delete;
+
+        OpeningBook &operator=(const OpeningBook &) = delete;
+
+        /**
+         * Open a book, closing the current one. Fails if the file is not a
+         * Polyglot book.
+         */
+        bool open(const std::string &path);
+
+        void close();
+
+        [[nodiscard]]
+        bool isOpen() const;
+
+        /**
+         * The legal moves the book knows for a position. Underpromotions,
+         * which the engine does not play, are left out.
+         */
+        [[nodiscard]]
+        std::vector<BookMove> moves(const Chess::Board &board) const;
+
+        [[nodiscard]]
+        std::optional<Chess::Move> selectMove(const Chess::Board &board, BookSelection selection);
+
+    private:
+        QFile file;
+
+        uchar *entries{nullptr};
+        std::size_t entryCount{0};
+
+        std::mt19937 random{std::random_device{}()};
+    };
+
+    namespace Polyglot {
+
+        /**
+         * The Polyglot hash of a position, which differs from Board::hash.
+         */
+        [[nodiscard]]
+        uint64_t hash(const Chess::Board &board);
+    }
+}
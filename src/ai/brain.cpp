@@ -1,10 +1,27 @@
 #include "brain.h"
+#include "timemanager.h"
+#include "pawns.h"
+#include "transposition.h"
+#include "evaluationcache.h"
+#include "nnue.h"
+#include "bitbase.h"
+#include "syzygy.h"
+#include "../trace/trace.h"
+#include "../trace/perfcounters.h"
 
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <utility>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace Ai {
 
@@ -17,291 +34,1912 @@ namespace Ai {
         300,
         100,
     };
+    //@formatter:on
 
-    static constexpr int positionWeights[2][6][64]{
-        {
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-            {
-                2, 3, 4, 3, 4, 3, 3, 2,
-                2, 3, 4, 4, 4, 4, 3, 2,
-                3, 4, 4, 4, 4, 4, 4, 3,
-                3, 3, 4, 4, 4, 4, 3, 3,
-                2, 3, 3, 4, 4, 3, 3, 2,
-                2, 2, 2, 3, 3, 2, 2, 2,
-                2, 2, 2, 2, 2, 2, 2, 2,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-            {
-                9, 9, 11, 10, 11, 9, 9, 9,
-                4, 6, 7, 9, 9, 7, 6, 4,
-                9, 10, 10, 11, 11, 10, 10, 9,
-                8, 8, 8, 9, 9, 8, 8, 8,
-                6, 6, 5, 6, 6, 5, 6, 6,
-                4, 5,  5,  5,  5,  5,  5,  4,
-                3, 4, 4, 6, 6, 4, 4, 3,
-                0, 0, 0,  0,  0,  0, 0, 0,
-            },
-            {
-                2, 3, 4, 4, 4, 4, 3, 2,
-                4, 7, 7, 7, 7, 7, 7, 4,
-                3, 5, 6, 6,  6,  6, 5, 3,
-                3, 5, 7, 7, 7, 7, 5, 3,
-                4, 5, 6, 8, 8, 6, 5, 4,
-                4, 5, 5, -2, -2, 5, 5, 4,
-                5, 5, 5, 3, 3, 5, 5, 5,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-            {
-                -2, 2,  7,  9,  9,  7,  2,  -2,
-                1,  4,  12, 13, 13, 12, 4,  1,
-                5,  11, 18, 19, 19, 18, 11, 5,
-                3, 10, 14, 14, 14, 14, 10, 3,
-                0, 5,  8,  9,  9,  8,  5,  0,
-                -3, 1,  3,  4,  4,  3,  1,  -3,
-                -5, -3, -1, 0,  0,  -1, -3, -5,
-                -7, -5, -4, -2, -2, -4, -5, -7,
-            },
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                7,  7,  13, 23, 26, 13, 7,  7,
-                -2, -2, 4, 12, 15, 4, -2, -2,
-                -3, -3, 2, 9, 11, 2, -3, -3,
-                -4, -4, 0, 6, 8,  0, -4, -4,
-                -4, -4, 0, 4,  6,  0, -4, -4,
-                -1, -1, 1,  5,  6,  1,  -1, -1,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-        },
-        {
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                2, 2, 2, 2, 2, 2, 2, 2,
-                2, 2, 2, 3, 3, 2, 2, 2,
-                2, 3, 3, 4, 4, 3, 3, 2,
-                3, 3, 4, 4, 4, 4, 3, 3,
-                3, 4, 4, 4, 4, 4, 4, 3,
-                2, 3, 4, 4, 4, 4, 3, 2,
-                2, 3, 4, 3, 4, 3, 3, 2,
-            },
-            {
-                0, 0, 0,  0,  0,  0, 0, 0,
-                3, 4, 4, 6, 6, 4, 4, 3,
-                4, 5,  5,  5,  5,  5,  5,  4,
-                6, 6, 5, 6, 6, 5, 6, 6,
-                8, 8, 8, 9, 9, 8, 8, 8,
-                9, 10, 10, 11, 11, 10, 10, 9,
-                4, 6, 7, 9, 9, 7, 6, 4,
-                9, 9, 11, 10, 11, 9, 9, 9,
-            },
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                5, 5, 5, 3, 3, 5, 5, 5,
-                4, 5, 5, -2, -2, 5, 5, 4,
-                4, 5, 6, 8, 8, 6, 5, 4,
-                3, 5, 7, 7, 7, 7, 5, 3,
-                3, 5, 6, 6,  6,  6, 5, 3,
-                4, 7, 7, 7, 7, 7, 7, 4,
-                2, 3, 4, 4, 4, 4, 3, 2,
-            },
-            {
-                -7, -5, -4, -2, -2, -4, -5, -7,
-                -5, -3, -1, 0,  0,  -1, -3, -5,
-                -3, 1,  3,  4,  4,  3,  1,  -3,
-                0, 5,  8,  9,  9,  8,  5,  0,
-                3, 10, 14, 14, 14, 14, 10, 3,
-                5,  11, 18, 19, 19, 18, 11, 5,
-                1,  4,  12, 13, 13, 12, 4,  1,
-                -2, 2,  7,  9,  9,  7,  2,  -2,
-            },
-            {
-                0, 0, 0, 0, 0, 0, 0, 0,
-                -1, -1, 1,  5,  6,  1,  -1, -1,
-                -4, -4, 0, 4,  6,  0, -4, -4,
-                -4, -4, 0, 6, 8,  0, -4, -4,
-                -3, -3, 2, 9, 11, 2, -3, -3,
-                -2, -2, 4, 12, 15, 4, -2, -2,
-                7,  7,  13, 23, 26, 13, 7,  7,
-                0, 0, 0, 0, 0, 0, 0, 0,
-            },
-        },
+    /**
+     * Scores fit in 16 bits, so they can be stored in the transposition table,
+     * and can always be negated. Mate scores are offset by the distance to the
+     * root, so that shorter mates are preferred.
+     */
+    static constexpr int infinity = 32000;
+    static constexpr int mateValue = 31000;
+
+    /**
+     * Upper bound on the search depth, which bounds the memory used by a search.
+     */
+    static constexpr int maxPly = 128;
+
+    static constexpr int mateThreshold = mateValue - maxPly;
+
+    /**
+     * Score of positions the bitbases know to be won, which outweighs any
+     * evaluation but stays clear of mate scores.
+     */
+    static constexpr int knownWinValue = 10000;
+
+    /**
+     * Score of positions the tablebases know to be won, above those of the
+     * bitbases. Like mate scores it is offset by the distance to the root.
+     */
+    static constexpr int tablebaseWinValue = 20000;
+
+    static constexpr int tablebaseWinThreshold = tablebaseWinValue - maxPly;
+
+    /**
+     * Shared by all searches, so results carry over between moves.
+     */
+    static TranspositionTable transpositionTable;
+
+    /**
+     * Shared by all searches as well. The scores depend on the evaluator, the
+     * network and the bitbases, so the cache is cleared whenever one of them
+     * changes.
+     */
+    static EvaluationCache evaluationCache;
+
+    /**
+     * Mate and tablebase scores are stored relative to the position rather
+     * than to the root, so that they stay correct when the position is
+     * reached at another ply.
+     */
+    static int scoreToTable(int score, int ply) {
+        if (score >= tablebaseWinThreshold)
+            return score + ply;
+        if (score <= -tablebaseWinThreshold)
+            return score - ply;
+        return score;
+    }
+
+    static int scoreFromTable(int score, int ply) {
+        if (score >= tablebaseWinThreshold)
+            return score - ply;
+        if (score <= -tablebaseWinThreshold)
+            return score + ply;
+        return score;
+    }
+
+    /**
+     * Room reserved for the moves of one position, enough for any legal chess position.
+     */
+    static constexpr int maxMoves = 256;
+
+    /**
+     * Time per move used by selectMove.
+     */
+    static constexpr std::chrono::milliseconds defaultMoveTime{15000};
+
+    /**
+     * Each thread only looks at the clock and the node limit once per this many nodes.
+     */
+    static constexpr int checkInterval = 1024;
+
+    /**
+     * Number of threads searching in parallel, including the main search thread.
+     */
+    static std::atomic<int> searchThreads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+
+    static std::atomic<ParallelMode> searchMode{ParallelMode::SharedHash};
+
+    /**
+     * Number of best root moves each search finds, see setMultiPv.
+     */
+    static std::atomic<int> searchLineCount{1};
+
+    static std::atomic<Evaluator> searchEvaluator{Evaluator::Classical};
+
+    static OpeningBook openingBook;
+
+    /**
+     * Set once loadBitbases has finished. The bitbases are loaded and
+     * generated in the background while the engine already plays, and are
+     * not probed until then.
+     */
+    static std::atomic<bool> bitbasesReady{false};
+
+    static std::atomic<BookSelection> bookMoveSelection{BookSelection::Weighted};
+
+    /**
+     * Positions visited by all threads of the last search.
+     */
+    static std::atomic<uint64_t> searchedNodes{0};
+
+    static std::atomic<uint64_t> evaluationCacheHits{0};
+    static std::atomic<uint64_t> evaluationCacheMisses{0};
+
+    /**
+     * What the running or last search has found, see searchProgress. Only
+     * written once per iteration, so a mutex costs nothing noticeable.
+     */
+    static SearchProgress currentProgress;
+    static std::mutex progressMutex;
+
+    /**
+     * Statistics of the last search, see searchStats.
+     */
+    static SearchStats lastSearchStats;
+    static std::mutex searchStatsMutex;
+
+    /**
+     * Whether the counters of SearchStats which cost speed are counted.
+     */
+#if defined(DEEPGREEN_SEARCH_STATS)
+    static constexpr bool isCountingSearchStats = true;
+#else
+    static constexpr bool isCountingSearchStats = false;
+#endif
+
+    /**
+     * Set by ponderHit, and taken by the running ponder search.
+     */
+    static std::atomic<bool> ponderHitReceived{false};
+
+    /**
+     * Set by stopSearch, and taken by the running search.
+     */
+    static std::atomic<bool> stopRequested{false};
+
+    /**
+     * Reply expected by the last search, see ponderMove.
+     */
+    static std::optional<Chess::Move> expectedReply;
+    static std::mutex expectedReplyMutex;
+
+    /**
+     * Split points are only made this far from the horizon, where the work
+     * handed out outweighs the cost of sharing it.
+     */
+    static constexpr int minSplitDepth = 4;
+
+    /**
+     * Half the width of the first aspiration window around the score of the
+     * previous iteration, and the first depth at which one is used.
+     */
+    static constexpr int aspirationWindow = 25;
+    static constexpr int aspirationDepth = 4;
+
+    /**
+     * Quiescence search skips captures which cannot raise the score to alpha
+     * even if the captured piece was won for free and this much more.
+     */
+    static constexpr int deltaMargin = 200;
+
+    /**
+     * Null move pruning is tried from this depth on, and searches the null
+     * move this much shallower, plus one ply for every nullMoveDepthDivisor plies of depth.
+     */
+    static constexpr int nullMoveDepth = 3;
+    static constexpr int nullMoveReduction = 3;
+    static constexpr int nullMoveDepthDivisor = 6;
+
+    /**
+     * Late move reductions start from this depth and this move number.
+     */
+    static constexpr int reductionDepth = 3;
+    static constexpr int reductionMoveNumber = 4;
+
+    /**
+     * Late move reductions, indexed by depth and move number. Moves searched
+     * later and at larger depths are less likely to be best, and are reduced more.
+     */
+    static const auto lateMoveReductions = [] {
+        std::array<std::array<int, 64>, 64> table{};
+        for (int depth = 1; depth < 64; ++depth) {
+            for (int moveNumber = 1; moveNumber < 64; ++moveNumber)
+                table[depth][moveNumber] = static_cast<int>(0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+        }
+        return table;
+    }();
+
+    /**
+     * History scores stay within plus and minus this value.
+     */
+    static constexpr int historyMax = 16384;
+
+    /**
+     * Ordering scores of the move classes of a node, searched in this order.
+     * Quiet moves without a class are ordered by their history score.
+     */
+    static constexpr int hashMoveScore = 1 << 30;
+    static constexpr int captureScore = 1 << 24;
+    static constexpr int killerScore = 1 << 20;
+    static constexpr int counterMoveScore = 1 << 19;
+
+    /**
+     * Bonus for captures on the target square of the previous move, which are often recaptures.
+     */
+    static constexpr int recaptureBonus = 1 << 16;
+
+    struct SearchContext;
+
+    /**
+     * State shared by all threads taking part in one search.
+     */
+    struct SearchShared {
+        SearchShared(const QPromise<Chess::Move> &promise, const SearchLimits &limits, ParallelMode mode,
+                     Evaluator evaluator)
+                : promise(promise),
+                  timeManager(limits),
+                  nodeLimit(limits.infinite ? 0 : limits.nodes),
+                  mode(mode),
+                  evaluator(evaluator),
+                  isPondering(limits.ponder) {}
+
+        const QPromise<Chess::Move> &promise;
+
+        TimeManager timeManager;
+
+        const uint64_t nodeLimit;
+
+        const ParallelMode mode;
+
+        const Evaluator evaluator;
+
+        std::atomic<bool> stop{false};
+
+        /**
+         * Nodes visited by all threads, counted in steps of checkInterval
+         */
+        std::atomic<uint64_t> nodes{0};
+
+        /**
+         * Every thread of the search, so that idle threads can steal work from the others
+         */
+        std::vector<SearchContext *> threads;
+
+        std::atomic<int> idleThreads{0};
+
+        /**
+         * Whether the search is still waiting for the ponder hit; only used by the main thread
+         */
+        bool isPondering;
     };
-    //@formatter:on
 
-    std::chrono::time_point<std::chrono::steady_clock> start;
+    /**
+     * Whether the search is still pondering, turning it into a normal search
+     * if the ponder hit has arrived. Only called by the main thread.
+     */
+    static bool isPondering(SearchShared &shared) {
+        if (shared.isPondering && ponderHitReceived.exchange(false, std::memory_order_relaxed)) {
+            shared.isPondering = false;
+            shared.timeManager.restart();
+        }
+        return shared.isPondering;
+    }
+
+    /**
+     * A node whose remaining moves are searched by several threads at once.
+     * It lives on the stack of the thread that made it, which waits for all
+     * helpers to leave before returning.
+     */
+    struct SplitPoint {
+        SplitPoint(const Chess::Board &board, SplitPoint *parent, const Chess::Move *moves, const int *reductions,
+                   int moveCount, int depth, int ply, int color, int alpha, int beta, int bestValue)
+                : board(board),
+                  parent(parent),
+                  moves(moves),
+                  reductions(reductions),
+                  moveCount(moveCount),
+                  depth(depth),
+                  ply(ply),
+                  color(color),
+                  beta(beta),
+                  alpha(alpha),
+                  bestValue(bestValue) {}
 
-    static constexpr std::chrono::milliseconds timeLimit{15000};
+        const Chess::Board board;
 
-    std::pair<int, int> negaMaxRoot(const QPromise<Chess::Move> &promise, const std::vector<Node> &rootChildren, int depth, int color);
+        /**
+         * The split point the owner was searching under, if any; a cutoff there cancels this one too
+         */
+        SplitPoint *const parent;
 
-    int negaMax(Node &node, int depth, int alpha, int beta, int color, bool &isOverTime);
+        const Chess::Move *const moves;
 
-    int staticEvaluation(const Chess::Board &chessBoard);
+        /**
+         * Late move reduction of each move, decided by the owner, or null for none
+         */
+        const int *const reductions;
 
-    void selectMove(QPromise<Chess::Move> &promise, const Chess::Board &board) {
-        auto chessBoard = Chess::Board(board);
-        auto moves = chessBoard.legalMoves();
-        assert(!moves.empty());
+        const int moveCount;
+
+        const int depth;
+        const int ply;
+        const int color;
+        const int beta;
+
+        std::atomic<int> nextMove{0};
+
+        /**
+         * Helper threads currently searching moves of this split point
+         */
+        std::atomic<int> workers{0};
+
+        std::atomic<bool> cutoff{false};
+
+        std::mutex mutex;
+
+        // Guarded by mutex, alpha can also be read without it
+        std::atomic<int> alpha;
+        int bestValue;
+        int bestIndex{-1};
+
+        /**
+         * Principal variation of the best move, if it raised alpha
+         */
+        std::vector<Chess::Move> pv;
+    };
+
+    /**
+     * A legal move at the root, together with what the searches so far found
+     * out about it. The list of root moves is kept sorted best first, so each
+     * iteration searches the best move of the previous one first.
+     */
+    struct RootMove {
+        explicit RootMove(const Chess::Move &move)
+                : move(move),
+                  pv{move} {}
 
-        int largestValue = std::numeric_limits<int>::min();
-        int largestValueIndex = -1;
+        Chess::Move move;
 
-        int depth = 1;
+        /**
+         * Score in the current iteration, or -infinity if the move has not
+         * been searched yet or did not raise alpha. For the first move it may
+         * be an upper bound after failing low.
+         */
+        int score{-infinity};
 
-        start = std::chrono::steady_clock::now();
+        /**
+         * Score in the last iteration, which orders moves of equal score
+         */
+        int previousScore{-infinity};
 
-        std::vector<Node> rootChildren;
-        rootChildren.reserve(moves.size());
-        for (auto move: moves) {
-            Chess::Board newBoard(board);
-            newBoard.performMove(move);
+        /**
+         * Principal variation, starting with the move itself
+         */
+        std::vector<Chess::Move> pv;
 
-            rootChildren.emplace_back(newBoard, nullptr, move);
+        [[nodiscard]]
+        bool operator<(const RootMove &other) const {
+            return (score != other.score) ? score > other.score : previousScore > other.previousScore;
         }
+    };
 
-        const int color = (board.turnToMove() == Chess::Color::White) ? 1 : -1;
+    /**
+     * Everything one search thread needs, allocated up front. The search makes
+     * and unmakes moves on a single board, and each ply generates its moves
+     * into its own preallocated list, so no memory is allocated per node.
+     *
+     * Contexts are aligned to cache lines, so that threads writing to their own
+     * context never invalidate a line another thread is using.
+     */
+    struct alignas(64) SearchContext {
+        SearchContext(const Chess::Board &board, SearchShared &shared, int threadIndex)
+                : board(board),
+                  shared(shared),
+                  threadIndex(threadIndex) {
+            for (auto &moves: moveStack)
+                moves.reserve(maxMoves);
+            for (auto &scores: scoreStack)
+                scores.reserve(maxMoves);
+            for (auto &pv: pvStack)
+                pv.reserve(maxPly);
+            splitPoints.reserve(maxPly);
+        }
 
-        while (std::chrono::steady_clock::now() - start < timeLimit) {
-            promise.suspendIfRequested();
+        Chess::Board board;
+
+        SearchShared &shared;
+
+        /**
+         * 0 for the main search thread, which owns time control and the result
+         */
+        const int threadIndex;
+
+        std::array<std::vector<Chess::Move>, maxPly> moveStack;
+
+        /**
+         * Ordering scores for the moves in moveStack at the same ply
+         */
+        std::array<std::vector<int>, maxPly> scoreStack;
+
+        /**
+         * Triangular principal variation table: the best line found from the
+         * node at each ply, filled in as alpha is raised
+         * See https://www.chessprogramming.org/Triangular_PV-Table
+         */
+        std::array<std::vector<Chess::Move>, maxPly + 1> pvStack;
+
+        /**
+         * Quiet moves which caused a beta cutoff at each ply, most recent first
+         */
+        std::array<std::array<uint16_t, 2>, maxPly> killers{};
+
+        PawnTable pawnTable;
+
+        /**
+         * Only used with the neural evaluator
+         */
+        Nnue::AccumulatorStack accumulators{maxPly + 1};
+
+        /**
+         * Butterfly history of quiet moves causing cutoffs, indexed by the
+         * Color enum and the origin and target squares of the move
+         */
+        int history[2][64][64]{};
+
+        /**
+         * The quiet move which last refuted a move, indexed by the origin and target squares of that move
+         */
+        uint16_t counterMoves[64][64]{};
+
+        /**
+         * The innermost split point this thread is searching under, if any
+         */
+        SplitPoint *splitPoint{nullptr};
+
+        /**
+         * Split points made by this thread which still have moves left, oldest
+         * first. Other threads steal from the front, where the subtrees are largest.
+         */
+        std::vector<SplitPoint *> splitPoints;
+        std::mutex splitPointsMutex;
+
+        uint64_t nodes{0};
+
+        uint64_t evaluationCacheHits{0};
+        uint64_t evaluationCacheMisses{0};
+
+        /**
+         * Only counted with isCountingSearchStats, see SearchStats
+         */
+        uint64_t quiescenceNodes{0};
+        uint64_t betaCutoffs{0};
+        uint64_t firstMoveCutoffs{0};
+        uint64_t hashProbes{0};
+        uint64_t hashHits{0};
+        int selectiveDepth{0};
+
+        /**
+         * Nodes left until this thread next checks the limits of the search
+         */
+        int nodesUntilCheck{checkInterval};
+
+        bool isStopped{false};
+    };
+
+    int negaMaxRoot(SearchContext &context, std::vector<RootMove> &rootMoves, std::size_t first, int depth,
+                    int alpha, int beta, int color);
+
+    int negaMax(SearchContext &context, int depth, int ply, int alpha, int beta, int color,
+                uint16_t previousMove);
+
+    int quiescence(SearchContext &context, int ply, int alpha, int beta, int color);
+
+    int staticEvaluation(const Chess::Board &chessBoard, PawnTable &pawnTable);
+
+    void search(QPromise<Chess::Move> &promise, const Chess::Board &board, const SearchLimits &limits);
+
+    void helperSearch(SearchContext &context, std::vector<RootMove> rootMoves, int maxDepth);
+
+    void splitPointHelper(SearchContext &context);
+
+    void setHashSize(std::size_t megabytes) {
+        transpositionTable.resize(megabytes);
+    }
+
+    std::size_t hashSize() {
+        return transpositionTable.size();
+    }
+
+    void clearHash() {
+        transpositionTable.clear();
+        evaluationCache.clear();
+    }
+
+    void setEvaluationCacheSize(std::size_t megabytes) {
+        evaluationCache.resize(megabytes);
+    }
+
+    std::size_t evaluationCacheSize() {
+        return evaluationCache.size();
+    }
+
+    EvaluationCacheStats evaluationCacheStats() {
+        return {evaluationCacheHits, evaluationCacheMisses};
+    }
+
+    bool loadNetwork(const std::string &path) {
+        if (!Nnue::loadNetwork(path))
+            return false;
+
+        // Scores of the previous network are no longer valid
+        evaluationCache.clear();
+        return true;
+    }
+
+    bool isNetworkLoaded() {
+        return Nnue::isNetworkLoaded();
+    }
+
+    void setEvaluator(Evaluator evaluator) {
+        if (searchEvaluator.exchange(evaluator) != evaluator)
+            evaluationCache.clear();
+    }
+
+    Evaluator evaluator() {
+        return searchEvaluator;
+    }
+
+    bool openBook(const std::string &path) {
+        return openingBook.open(path);
+    }
+
+    void closeBook() {
+        openingBook.close();
+    }
+
+    bool isBookOpen() {
+        return openingBook.isOpen();
+    }
+
+    void setBookSelection(BookSelection selection) {
+        bookMoveSelection = selection;
+    }
+
+    BookSelection bookSelection() {
+        return bookMoveSelection;
+    }
+
+    void loadBitbases(QPromise<int> &promise, const std::string &directory) {
+        bitbasesReady.store(false, std::memory_order_relaxed);
+
+        Bitbases::load(directory);
+        for (const auto *name: {"KQK", "KRK", "KPK"}) {
             if (promise.isCanceled())
                 return;
+            Bitbases::generate(name, searchThreads);
+        }
+
+        // Publishes the tables to the search threads which see the flag set
+        bitbasesReady.store(true, std::memory_order_release);
+
+        // Scores cached without the bitbases are no longer valid
+        evaluationCache.clear();
+        promise.addResult(static_cast<int>(Bitbases::available().size()));
+    }
+
+    int setTablebasePath(const std::string &path) {
+        return Syzygy::setPath(path);
+    }
+
+    void setThreadCount(int count) {
+        searchThreads = std::max(1, count);
+    }
+
+    int threadCount() {
+        return searchThreads;
+    }
+
+    void setParallelMode(ParallelMode mode) {
+        searchMode = mode;
+    }
+
+    ParallelMode parallelMode() {
+        return searchMode;
+    }
+
+    void setMultiPv(int count) {
+        searchLineCount = std::max(1, count);
+    }
+
+    int multiPv() {
+        return searchLineCount;
+    }
 
-            auto value = negaMaxRoot(promise, rootChildren, depth++, color);
-            if (value.first > largestValue) {
-                largestValue = value.first;
-                largestValueIndex = value.second;
+    uint64_t nodeCount() {
+        return searchedNodes;
+    }
+
+    /**
+     * A fraction from 0 to 1, or 0 with nothing counted
+     */
+    static double fraction(uint64_t part, uint64_t whole) {
+        return whole ? static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+
+    uint64_t SearchStats::nodesPerSecond() const {
+        return this->nodes * 1000 / std::max<uint64_t>(this->time.count(), 1);
+    }
+
+    double SearchStats::branchingFactor() const {
+        return this->previousIterationNodes ? static_cast<double>(this->lastIterationNodes) /
+                                              static_cast<double>(this->previousIterationNodes) : 0.0;
+    }
+
+    double SearchStats::firstMoveCutoffRate() const {
+        return fraction(this->firstMoveCutoffs, this->betaCutoffs);
+    }
+
+    double SearchStats::hashHitRate() const {
+        return fraction(this->hashHits, this->hashProbes);
+    }
+
+    double SearchStats::quiescenceRate() const {
+        return fraction(this->quiescenceNodes, this->nodes);
+    }
+
+    std::vector<SearchLine> searchLines() {
+        std::scoped_lock lock(progressMutex);
+        return currentProgress.lines;
+    }
+
+    SearchProgress searchProgress() {
+        std::scoped_lock lock(progressMutex);
+        return currentProgress;
+    }
+
+    SearchStats searchStats() {
+        std::scoped_lock lock(searchStatsMutex);
+        return lastSearchStats;
+    }
+
+    void ponderHit() {
+        ponderHitReceived.store(true, std::memory_order_relaxed);
+    }
+
+    void stopSearch() {
+        stopRequested.store(true, std::memory_order_relaxed);
+    }
+
+    std::optional<Chess::Move> ponderMove() {
+        std::scoped_lock lock(expectedReplyMutex);
+        return expectedReply;
+    }
+
+    void selectMove(QPromise<Chess::Move> &promise, const Chess::Board &board) {
+        SearchLimits limits;
+        limits.moveTime = defaultMoveTime;
+        search(promise, board, limits);
+    }
+
+    void selectMoveToDepth(QPromise<Chess::Move> &promise, const Chess::Board &board, int depth) {
+        SearchLimits limits;
+        limits.depth = std::max(depth, 1);
+        search(promise, board, limits);
+    }
+
+    void selectMoveWithLimits(QPromise<Chess::Move> &promise, const Chess::Board &board,
+                              const SearchLimits &limits) {
+        search(promise, board, limits);
+    }
+
+    /**
+     * The legal moves which keep the best result according to the
+     * tablebases, or none if the position is not in them. Wins the fifty
+     * move rule lets stand rank above cursed ones, and among wins the moves
+     * reaching the next capture or pawn move soonest are kept, among losses
+     * those reaching it latest. isDecisive tells whether the result is a win
+     * or loss, in which case there is nothing left to search for.
+     */
+    static std::vector<Chess::Move> tablebaseMoves(Chess::Board board, bool &isDecisive) {
+        isDecisive = false;
+
+        const auto moves = board.legalMoves();
+        if (moves.empty())
+            return {};
+
+        const auto distances = Syzygy::probeRootMoves(board, moves);
+        if (!distances)
+            return {};
+
+        const int clock = board.halfMoveClock();
+        const auto rank = [clock](int dtz) {
+            const int result = (dtz > 0) ? (dtz + clock <= 99 ? 2 : 1)
+                                         : (dtz < 0) ? (clock - dtz <= 99 ? -2 : -1) : 0;
+            return std::pair(result, -dtz);
+        };
+
+        std::vector<Chess::Move> bestMoves;
+        auto bestRank = rank(distances->front());
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            const auto moveRank = rank((*distances)[i]);
+            if (moveRank > bestRank) {
+                bestRank = moveRank;
+                bestMoves.clear();
             }
+            if (moveRank == bestRank)
+                bestMoves.push_back(moves[i]);
         }
 
-        assert(largestValueIndex != -1);
-        promise.addResult(moves[largestValueIndex]);
+        isDecisive = bestRank.first != 0;
+        return bestMoves;
     }
 
-    std::pair<int, int> negaMaxRoot(const QPromise<Chess::Move> &promise, const std::vector<Node> &rootChildren, int depth, int color) {
-        if (depth <= 0)
-            return {0, 0};
+    /**
+     * What the search found out about a root move, as a line for searchLines.
+     */
+    static SearchLine searchLine(const RootMove &rootMove, int depth) {
+        SearchLine line{rootMove.pv, rootMove.score, 0, depth};
+        if (rootMove.score >= mateThreshold)
+            line.mate = (mateValue - rootMove.score + 1) / 2;
+        else if (rootMove.score <= -mateThreshold)
+            line.mate = -(mateValue + rootMove.score) / 2;
+        return line;
+    }
+
+    /**
+     * Only the main thread runs iterative deepening. With shared hash
+     * searching, helper threads run their own iterative deepening searches,
+     * while with split points they wait for work handed out by other threads.
+     */
+    void search(QPromise<Chess::Move> &promise, const Chess::Board &board, const SearchLimits &limits) {
+        Trace::setThreadName("Search");
+        Trace::Span searchSpan("Search", "search", {"threads", searchThreads.load()});
+
+        // Without a network, the classical evaluation is used whatever is selected
+        const auto evaluator = Nnue::isNetworkLoaded() ? searchEvaluator.load() : Evaluator::Classical;
+        SearchShared shared(promise, limits, searchMode, evaluator);
+        auto &timeManager = shared.timeManager;
+
+        {
+            std::scoped_lock lock(progressMutex);
+            currentProgress = {};
+            currentProgress.key = board.hash();
+        }
+
+        auto instantMove = openingBook.selectMove(board, bookMoveSelection);
+
+        // Only moves keeping the best result according to the tablebases are
+        // searched, and with a win or loss there is nothing to search for
+        bool isTablebaseDecisive = false;
+        const auto tablebaseRootMoves = instantMove ? std::vector<Chess::Move>()
+                                                    : tablebaseMoves(board, isTablebaseDecisive);
+        if (isTablebaseDecisive)
+            instantMove = tablebaseRootMoves.front();
+
+        if (instantMove) {
+            Trace::instant(isTablebaseDecisive ? "Tablebase move" : "Book move", "search");
+
+            // A ponder search waits for the ponder hit, just without searching
+            while (!promise.isCanceled() && isPondering(shared))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-        std::pair<int, int> ret{std::numeric_limits<int>::min(), -1};
+            if (limits.ponder)
+                ponderHitReceived.store(false, std::memory_order_relaxed);
+            stopRequested.store(false, std::memory_order_relaxed);
 
-        bool isOverTime = false;
+            searchedNodes = 0;
+            evaluationCacheHits = 0;
+            evaluationCacheMisses = 0;
+            {
+                std::scoped_lock lock(searchStatsMutex);
+                lastSearchStats = {};
+            }
 
-        for (int i = 0; i < rootChildren.size(); ++i) {
             if (promise.isCanceled())
+                return;
+
+            // Expect the reply the book or the tablebases like best, so that
+            // pondering stays in the book or the tablebases too
+            auto position = board;
+            position.performMove(*instantMove);
+            auto reply = openingBook.selectMove(position, BookSelection::Best);
+            if (!reply) {
+                bool isReplyDecisive;
+                if (const auto replies = tablebaseMoves(position, isReplyDecisive); !replies.empty())
+                    reply = replies.front();
+            }
+            {
+                std::scoped_lock lock(expectedReplyMutex);
+                expectedReply = reply;
+            }
+
+            promise.addResult(*instantMove);
+            return;
+        }
+
+        const int maxDepth = (limits.depth > 0 && !limits.infinite) ? std::min(limits.depth, maxPly - 1)
+                                                                    : maxPly - 1;
+
+        const int threadCount = searchThreads;
+
+        // The depth of every completed iteration is reported as progress, see searchProgress
+        promise.setProgressRange(0, maxDepth);
+
+        std::vector<std::unique_ptr<SearchContext>> contexts;
+        contexts.reserve(threadCount);
+        for (int i = 0; i < threadCount; ++i) {
+            contexts.push_back(std::make_unique<SearchContext>(board, shared, i));
+            shared.threads.push_back(contexts.back().get());
+        }
+
+        auto &context = *contexts.front();
+
+        std::vector<RootMove> rootMoves;
+        for (const auto &move: tablebaseRootMoves.empty() ? context.board.legalMoves() : tablebaseRootMoves)
+            rootMoves.emplace_back(move);
+        assert(!rootMoves.empty());
+
+        const auto lineCount = std::min<std::size_t>(searchLineCount.load(), rootMoves.size());
+
+        transpositionTable.newSearch();
+
+        std::vector<std::thread> helpers;
+        helpers.reserve(threadCount - 1);
+        for (int i = 1; i < threadCount; ++i) {
+            if (shared.mode == ParallelMode::SharedHash)
+                helpers.emplace_back(helperSearch, std::ref(*contexts[i]), rootMoves, maxDepth);
+            else
+                helpers.emplace_back(splitPointHelper, std::ref(*contexts[i]));
+        }
+
+        int previousScore = 0;
+
+        const int color = (board.turnToMove() == Chess::Color::White) ? 1 : -1;
+
+        SearchStats stats;
+
+        for (int depth = 1; depth <= maxDepth; ++depth) {
+            promise.suspendIfRequested();
+            if (promise.isCanceled() || (!isPondering(shared) && timeManager.isHardLimitReached()))
                 break;
 
-            Node node(rootChildren[i]);
+            const auto iterationStartNodes = context.nodes;
+            Trace::Span iterationSpan("Iteration", "search", {"depth", depth});
+
+            const auto previousBestMove = rootMoves.front().move;
+            for (auto &rootMove: rootMoves) {
+                rootMove.previousScore = rootMove.score;
+                rootMove.score = -infinity;
+            }
+
+            // MultiPV: each line searches the moves not in an earlier line, and
+            // so finds the best of them
+            for (std::size_t line = 0; line < lineCount && !context.isStopped; ++line) {
+                // Aspiration windows: expect the score to stay close to that of the
+                // previous iteration, and widen the window whenever it does not
+                const int lineScore = rootMoves[line].previousScore;
+                int delta = aspirationWindow;
+                int alpha = -infinity;
+                int beta = infinity;
+                if (depth >= aspirationDepth && std::abs(lineScore) < mateThreshold) {
+                    alpha = std::max(lineScore - delta, -infinity);
+                    beta = std::min(lineScore + delta, infinity);
+                }
+
+                while (true) {
+                    const auto value = negaMaxRoot(context, rootMoves, line, depth, alpha, beta, color);
+
+                    // Moves which were not searched, or did not raise alpha, keep
+                    // their order. This brings a move which beat the lower bound
+                    // to the front even if the search was stopped afterwards.
+                    std::stable_sort(rootMoves.begin() + static_cast<std::ptrdiff_t>(line), rootMoves.end());
 
-            auto value = negaMax(node, depth, std::numeric_limits<int>::min(),
-                                 std::numeric_limits<int>::max(), color, isOverTime);
-            if (isOverTime)
+                    if (context.isStopped)
+                        break;
+
+                    if (value <= alpha) {
+                        Trace::instant("Fail low", "search", {"score", value});
+                        beta = (alpha + beta) / 2;
+                        alpha = std::max(value - delta, -infinity);
+                    } else if (value >= beta) {
+                        Trace::instant("Fail high", "search", {"score", value});
+                        beta = std::min(value + delta, infinity);
+                    } else {
+                        break;
+                    }
+
+                    delta *= 2;
+                }
+            }
+
+            if (context.isStopped)
                 break;
 
-            if (value > ret.first) {
-                ret = {value, i};
+            // A later line may have scored above an earlier one, as searches are not exact
+            std::stable_sort(rootMoves.begin(), rootMoves.begin() + static_cast<std::ptrdiff_t>(lineCount));
+            previousScore = rootMoves.front().score;
+
+            {
+                SearchProgress progress{{}, depth, shared.nodes.load(std::memory_order_relaxed),
+                                        timeManager.elapsed(), board.hash()};
+                for (std::size_t line = 0; line < lineCount; ++line)
+                    progress.lines.push_back(searchLine(rootMoves[line], depth));
+
+                std::scoped_lock lock(progressMutex);
+                currentProgress = std::move(progress);
+            }
+            promise.setProgressValue(depth);
+
+            stats.depth = depth;
+            stats.previousIterationNodes = stats.lastIterationNodes;
+            stats.lastIterationNodes = context.nodes - iterationStartNodes;
+            iterationSpan.setResult({"score", previousScore});
+
+            timeManager.update(rootMoves.front().move != previousBestMove, previousScore);
+            if (!isPondering(shared) && timeManager.isSoftLimitReached()) {
+                Trace::instant("Soft limit reached", "time", {"elapsed ms", timeManager.elapsed().count()});
+                break;
             }
         }
 
-        return ret;
+        // A ponder search which ran out of depth holds on to its move until
+        // the ponder hit arrives, or it is canceled after a miss
+        while (!promise.isCanceled() && isPondering(shared))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        shared.stop = true;
+        for (auto &helper: helpers)
+            helper.join();
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        for (const auto &threadContext: contexts) {
+            stats.nodes += threadContext->nodes;
+            stats.quiescenceNodes += threadContext->quiescenceNodes;
+            stats.betaCutoffs += threadContext->betaCutoffs;
+            stats.firstMoveCutoffs += threadContext->firstMoveCutoffs;
+            stats.hashProbes += threadContext->hashProbes;
+            stats.hashHits += threadContext->hashHits;
+            stats.selectiveDepth = std::max(stats.selectiveDepth, threadContext->selectiveDepth);
+            hits += threadContext->evaluationCacheHits;
+            misses += threadContext->evaluationCacheMisses;
+        }
+        searchedNodes = stats.nodes;
+        evaluationCacheHits = hits;
+        evaluationCacheMisses = misses;
+
+        stats.time = timeManager.elapsed();
+        stats.memory = (transpositionTable.size() + evaluationCache.size()) * 1024 * 1024 +
+                       contexts.size() * (sizeof(SearchContext) + context.pawnTable.byteSize());
+        stats.hasDetails = isCountingSearchStats;
+        {
+            std::scoped_lock lock(searchStatsMutex);
+            lastSearchStats = stats;
+        }
+        {
+            std::scoped_lock lock(progressMutex);
+            currentProgress.nodes = stats.nodes;
+            currentProgress.time = stats.time;
+        }
+
+        // A hit arriving after the search was canceled must not carry over to
+        // the next ponder search, nor a stop arriving as it ended to the next search
+        if (limits.ponder)
+            ponderHitReceived.store(false, std::memory_order_relaxed);
+        stopRequested.store(false, std::memory_order_relaxed);
+
+        if (promise.isCanceled())
+            return;
+
+        {
+            const auto &pv = rootMoves.front().pv;
+            std::scoped_lock lock(expectedReplyMutex);
+            expectedReply = (pv.size() > 1) ? std::optional(pv[1]) : std::nullopt;
+        }
+
+        promise.addResult(rootMoves.front().move);
     }
 
-    int negaMax(Node &node, int depth, int alpha, int beta, int color, bool &isOverTime) {
-        // if depth is 0 or node has no children return static evaluation * color.
-        if (depth <= 0)
-            return color * staticEvaluation(node.chessBoard);
-
-        // Child nodes = generateMoves(node)
-        auto moves = node.chessBoard.pseudoLegalMoves();
-
-        // Order child nodes by move priority:
-        // Best move from grandparent node - later
-        // > capture last piece moved
-        // > other captures
-        // > center of the board
-        if (node.move) {
-            std::sort(moves.begin(), moves.end(), [&](Chess::Move a, Chess::Move b) {
-                if (a.to == node.move->to) {
-                    if (b.to != node.move->to)
-                        return true;
-                    // else compare in a different way
+    /**
+     * Lazy SMP: every thread runs its own iterative deepening search of the
+     * root position, and the threads cooperate only through the shared
+     * transposition table. Helper threads skip some depths, so that they run
+     * ahead of the main thread and fill the table with results it will need.
+     * See https://www.chessprogramming.org/Lazy_SMP
+     */
+    void helperSearch(SearchContext &context, std::vector<RootMove> rootMoves, int maxDepth) {
+        // Which depths each helper skips, repeating every 20 threads
+        static constexpr int skipSize[20]{1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+        static constexpr int skipPhase[20]{0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+        const int index = (context.threadIndex - 1) % 20;
+        const int color = (context.board.turnToMove() == Chess::Color::White) ? 1 : -1;
+
+        Trace::setThreadName("Search helper");
+
+        for (int depth = 1; depth <= maxDepth && !context.isStopped; ++depth) {
+            if (((depth + skipPhase[index]) / skipSize[index]) % 2 != 0)
+                continue;
+
+            Trace::Span iterationSpan("Helper iteration", "search", {"depth", depth});
+
+            for (auto &rootMove: rootMoves) {
+                rootMove.previousScore = rootMove.score;
+                rootMove.score = -infinity;
+            }
+
+            negaMaxRoot(context, rootMoves, 0, depth, -infinity, infinity, color);
+            std::stable_sort(rootMoves.begin(), rootMoves.end());
+        }
+    }
+
+    /**
+     * Whether the search has been stopped, or a split point the thread is
+     * searching under has been cut off, making its work useless.
+     */
+    static bool isAborted(const SearchContext &context) {
+        if (context.shared.stop.load(std::memory_order_relaxed))
+            return true;
+
+        for (auto splitPoint = context.splitPoint; splitPoint; splitPoint = splitPoint->parent) {
+            if (splitPoint->cutoff.load(std::memory_order_relaxed))
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Stop the search if it has reached its limits. Only the main thread
+     * looks at the clock, the node limit and the promise; helper threads stop
+     * when the main thread tells them to.
+     */
+    static void checkLimits(const SearchContext &context) {
+        auto &shared = context.shared;
+
+        if (context.threadIndex != 0 || shared.stop.load(std::memory_order_relaxed))
+            return;
+
+        const bool isCanceled = shared.promise.isCanceled();
+        if (isCanceled ||
+            (!isPondering(shared) &&
+             (shared.timeManager.isHardLimitReached() || stopRequested.load(std::memory_order_relaxed) ||
+              (shared.nodeLimit && shared.nodes.load(std::memory_order_relaxed) >= shared.nodeLimit)))) {
+            Trace::instant(isCanceled ? "Search canceled" : "Search limit reached", "time",
+                           {"elapsed ms", shared.timeManager.elapsed().count()});
+            shared.stop.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Count a visited node at the given distance from the root, and check
+     * the limits of the search every checkInterval nodes.
+     */
+    static void countNode(SearchContext &context, int ply) {
+        ++context.nodes;
+        if constexpr (isCountingSearchStats)
+            context.selectiveDepth = std::max(context.selectiveDepth, ply);
 
+        if (--context.nodesUntilCheck > 0)
+            return;
+        context.nodesUntilCheck = checkInterval;
+
+        context.shared.nodes.fetch_add(checkInterval, std::memory_order_relaxed);
+        checkLimits(context);
+    }
+
+    /**
+     * Young Brothers Wait: a node is only split once its first move has been
+     * searched, since that either cuts off or sets the bound the other moves
+     * are searched with.
+     * See https://www.chessprogramming.org/Young_Brothers_Wait_Concept
+     */
+    static bool canSplit(const SearchContext &context, int depth) {
+        return context.shared.mode == ParallelMode::SplitPoint &&
+               depth >= minSplitDepth &&
+               context.shared.idleThreads.load(std::memory_order_relaxed) > 0;
+    }
+
+    /**
+     * Principal variation search: once the first move of a node has been
+     * searched, the other moves are expected to be worse. They are searched
+     * with a null window, which only proves that, and searched again with the
+     * full window when they turn out to be better.
+     * See https://www.chessprogramming.org/Principal_Variation_Search
+     *
+     * A move may also be searched with reduced depth, and is searched again
+     * with full depth if it beats alpha anyway. Moves giving check are never reduced.
+     */
+    static int searchMove(SearchContext &context, const Chess::Move &move, int depth, int ply,
+                          int alpha, int beta, int color, bool isFirstMove, int reduction = 0) {
+        auto &board = context.board;
+
+        board.performMove(move);
+        transpositionTable.prefetch(board.hash());
+
+        if (reduction > 0 && board.isInCheck())
+            reduction = 0;
+
+        int score;
+        if (isFirstMove) {
+            score = -negaMax(context, depth - 1, ply + 1, -beta, -alpha, -color, encodeMove(move));
+        } else {
+            score = -negaMax(context, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, -color, encodeMove(move));
+            if (score > alpha && reduction > 0 && !context.isStopped)
+                score = -negaMax(context, depth - 1, ply + 1, -alpha - 1, -alpha, -color, encodeMove(move));
+            if (score > alpha && score < beta && !context.isStopped)
+                score = -negaMax(context, depth - 1, ply + 1, -beta, -alpha, -color, encodeMove(move));
+        }
+
+        board.undoMove();
+
+        return score;
+    }
+
+    /**
+     * Search moves of a split point until none are left. The board of the
+     * context must be at the position of the split point.
+     */
+    static void searchSplitPoint(SearchContext &context, SplitPoint &splitPoint) {
+        while (true) {
+            const int i = splitPoint.nextMove.fetch_add(1, std::memory_order_relaxed);
+            if (i >= splitPoint.moveCount)
+                break;
+
+            if (isAborted(context)) {
+                context.isStopped = true;
+                break;
+            }
+
+            const auto &move = splitPoint.moves[i];
+            const int alpha = splitPoint.alpha.load(std::memory_order_relaxed);
+
+            const int reduction = splitPoint.reductions ? splitPoint.reductions[i] : 0;
+
+            // The first move of a split point has always been searched before it was split
+            const auto score = searchMove(context, move, splitPoint.depth, splitPoint.ply, alpha, splitPoint.beta,
+                                          splitPoint.color, false, reduction);
+
+            if (context.isStopped)
+                break;
+
+            std::scoped_lock lock(splitPoint.mutex);
+
+            if (score > splitPoint.bestValue) {
+                splitPoint.bestValue = score;
+                splitPoint.bestIndex = i;
+            }
+
+            if (score > splitPoint.alpha.load(std::memory_order_relaxed)) {
+                const auto &childPv = context.pvStack[splitPoint.ply + 1];
+                splitPoint.pv.assign(1, move);
+                splitPoint.pv.insert(splitPoint.pv.end(), childPv.begin(), childPv.end());
+
+                splitPoint.alpha.store(score, std::memory_order_relaxed);
+                if (score >= splitPoint.beta) {
+                    // The first move of a split point was searched before it was split
+                    if constexpr (isCountingSearchStats)
+                        ++context.betaCutoffs;
+
+                    // Helpers still searching siblings see this and return
+                    splitPoint.cutoff.store(true, std::memory_order_relaxed);
+                    break;
                 }
-                return false;
-            });
+            }
         }
+    }
 
-        for (auto move: moves) {
-            // Copy board
-            // Perform move
-            // Create node
-            // Add to children vector
-            Chess::Board chessBoard(node.chessBoard); // TODO: Needs constructor without copying move vector
-            chessBoard.performMove(move);
-            node.children.emplace_back(chessBoard, &node, move);
+    /**
+     * Hand out the remaining moves of a node to idle threads, and search them
+     * together with the helpers. Returns the best score and the index of the
+     * best move, or -1 when no move beat the given best value.
+     */
+    static std::pair<int, int> split(SearchContext &context, const Chess::Move *moves, const int *reductions,
+                                     int moveCount, int depth, int ply, int color, int alpha, int beta,
+                                     int bestValue) {
+        SplitPoint splitPoint(context.board, context.splitPoint, moves, reductions, moveCount,
+                              depth, ply, color, alpha, beta, bestValue);
+
+        {
+            std::scoped_lock lock(context.splitPointsMutex);
+            context.splitPoints.push_back(&splitPoint);
         }
 
-        if (node.children.empty())
-            return color * staticEvaluation(node.chessBoard);
+        context.splitPoint = &splitPoint;
+        searchSplitPoint(context, splitPoint);
 
-        int value = std::numeric_limits<int>::min();
+        {
+            // Once removed, no more helpers can join
+            std::scoped_lock lock(context.splitPointsMutex);
+            std::erase(context.splitPoints, &splitPoint);
+        }
+
+        // The main thread does not visit nodes while it waits, so it checks the limits here
+        while (splitPoint.workers.load(std::memory_order_acquire) > 0) {
+            checkLimits(context);
+            std::this_thread::yield();
+        }
+
+        context.splitPoint = splitPoint.parent;
+
+        // A cutoff at this split point is a result, not a reason to stop
+        if (context.isStopped)
+            context.isStopped = isAborted(context);
+
+        std::scoped_lock lock(splitPoint.mutex);
+        if (!splitPoint.pv.empty())
+            context.pvStack[ply] = splitPoint.pv;
+        return {splitPoint.bestValue, splitPoint.bestIndex};
+    }
+
+    /**
+     * Join a split point of another thread which still has moves left, if there is one.
+     */
+    static SplitPoint *stealSplitPoint(const SearchContext &context) {
+        const auto &threads = context.shared.threads;
+
+        for (std::size_t i = 1; i < threads.size(); ++i) {
+            auto &victim = *threads[(context.threadIndex + i) % threads.size()];
+
+            std::scoped_lock lock(victim.splitPointsMutex);
+            for (auto splitPoint: victim.splitPoints) {
+                if (splitPoint->nextMove.load(std::memory_order_relaxed) < splitPoint->moveCount &&
+                    !splitPoint->cutoff.load(std::memory_order_relaxed)) {
+                    splitPoint->workers.fetch_add(1, std::memory_order_relaxed);
+                    return splitPoint;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    void splitPointHelper(SearchContext &context) {
+        auto &shared = context.shared;
+
+        Trace::setThreadName("Search helper");
+
+        shared.idleThreads.fetch_add(1, std::memory_order_relaxed);
+
+        while (!shared.stop.load(std::memory_order_relaxed)) {
+            auto splitPoint = stealSplitPoint(context);
+            if (!splitPoint) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            shared.idleThreads.fetch_sub(1, std::memory_order_relaxed);
+
+            context.board = splitPoint->board;
+            context.splitPoint = splitPoint;
+            {
+                Trace::Span splitPointSpan("Split point", "search", {"depth", splitPoint->depth});
+                searchSplitPoint(context, *splitPoint);
+            }
+            context.splitPoint = nullptr;
+            context.isStopped = false;
+
+            splitPoint->workers.fetch_sub(1, std::memory_order_release);
+
+            shared.idleThreads.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Search the root moves from first on within the window given by alpha
+     * and beta, and record the score and principal variation of each move
+     * that raised alpha, or was searched first. Moves before first are left
+     * out, as they are the lines already found by MultiPV. Returns the best
+     * score, which is only a bound when it falls outside the window.
+     */
+    int negaMaxRoot(SearchContext &context, std::vector<RootMove> &rootMoves, std::size_t first, int depth,
+                    int alpha, int beta, int color) {
+        if (depth <= 0)
+            return 0;
+
+        int value = -infinity;
 
-        for (auto child: node.children) {
-            if (std::chrono::steady_clock::now() - start >= timeLimit) {
-                isOverTime = true;
+        for (std::size_t i = first; i < rootMoves.size(); ++i) {
+            if (isAborted(context)) {
+                context.isStopped = true;
                 break;
             }
 
-            value = std::max(value, -negaMax(child, depth - 1, -beta, -alpha, -color, isOverTime));
-            if (isOverTime)
+            auto &rootMove = rootMoves[i];
+
+            const auto score = searchMove(context, rootMove.move, depth, 0, alpha, beta, color, i == first);
+
+            if (context.isStopped)
                 break;
 
+            if (i == first || score > alpha) {
+                const auto &childPv = context.pvStack[1];
+                rootMove.score = score;
+                rootMove.pv.assign(1, rootMove.move);
+                rootMove.pv.insert(rootMove.pv.end(), childPv.begin(), childPv.end());
+            }
+
+            value = std::max(value, score);
             alpha = std::max(alpha, value);
             if (alpha >= beta)
                 break;
+
+            // The root is always split once its first move has been searched
+            if (i == first && rootMoves.size() > first + 1 && context.shared.mode == ParallelMode::SplitPoint &&
+                context.shared.threads.size() > 1) {
+                // Split points take a plain array of moves, and ply 0 of the move stack is free at the root
+                auto &moves = context.moveStack[0];
+                moves.clear();
+                for (std::size_t j = first + 1; j < rootMoves.size(); ++j)
+                    moves.push_back(rootMoves[j].move);
+
+                context.pvStack[0].clear();
+                const auto [splitValue, index] = split(context, moves.data(), nullptr, static_cast<int>(moves.size()),
+                                                       depth, 0, color, alpha, beta, value);
+
+                // Only the best move of a split point is known, the others did not raise alpha
+                if (index != -1 && splitValue > alpha) {
+                    auto &bestRootMove = rootMoves[first + 1 + index];
+                    bestRootMove.score = splitValue;
+                    bestRootMove.pv = context.pvStack[0];
+                }
+                if (index != -1)
+                    value = splitValue;
+                break;
+            }
+        }
+
+        return value;
+    }
+
+    /**
+     * Make the principal variation of the node at this ply the move followed
+     * by the principal variation of the node it leads to.
+     */
+    static void updatePv(SearchContext &context, int ply, const Chess::Move &move) {
+        auto &pv = context.pvStack[ply];
+        const auto &childPv = context.pvStack[ply + 1];
+        pv.assign(1, move);
+        pv.insert(pv.end(), childPv.begin(), childPv.end());
+    }
+
+    /**
+     * Look up a position in the bitbases, once they are ready.
+     */
+    static std::optional<Bitbases::Result> probeBitbases(const Chess::Board &board) {
+        if (!bitbasesReady.load(std::memory_order_acquire))
+            return std::nullopt;
+        return Bitbases::probe(board);
+    }
+
+    /**
+     * Exact evaluation from white's point of view of a position in the
+     * bitbases. Won positions are ranked by how close they are to the end,
+     * so that the search makes progress: by material, the winning pawns
+     * advancing, the losing king being driven to the edge and the winning
+     * king coming closer.
+     */
+    static std::optional<int> bitbaseEvaluation(const Chess::Board &board) {
+        const auto result = probeBitbases(board);
+        if (!result)
+            return std::nullopt;
+        if (*result == Bitbases::Result::Draw)
+            return 0;
+
+        const auto winner = (*result == Bitbases::Result::Win) ? board.turnToMove()
+                                                                : Chess::oppositeTeam(board.turnToMove());
+        const int winningKing = static_cast<int>(board.kingSquare(winner));
+        const int losingKing = static_cast<int>(board.kingSquare(Chess::oppositeTeam(winner)));
+
+        // Manhattan distance of the losing king from the centre, 0 to 6
+        const int edgeCloseness = (std::abs(2 * (losingKing % 8) - 7) + std::abs(2 * (losingKing / 8) - 7)) / 2 - 1;
+        const int kingDistance = std::max(std::abs(winningKing % 8 - losingKing % 8),
+                                          std::abs(winningKing / 8 - losingKing / 8));
+
+        int pawnAdvance = 0;
+        for (auto pawns = board.pieces(winner, Chess::PieceType::Pawn); pawns;) {
+            const int rank = static_cast<int>(pawns.popLowestSquare()) / 8;
+            pawnAdvance += (winner == Chess::Color::White) ? rank : 7 - rank;
+        }
+
+        const int sign = (winner == Chess::Color::White) ? 1 : -1;
+        return sign * (knownWinValue + sign * board.pieceSquareScore() + 20 * pawnAdvance + 20 * edgeCloseness -
+                       20 * kingDistance);
+    }
+
+    /**
+     * Static evaluation of the position of the thread from white's point of
+     * view, looked up in the evaluation cache first.
+     */
+    static int evaluate(SearchContext &context) {
+        // Probing the evaluation cache counts as hash probing
+        PerfCounters::Scope scope(PerfCounters::Region::Evaluation);
+
+        const auto key = context.board.hash();
+
+        int score;
+        if (evaluationCache.probe(key, score)) {
+            ++context.evaluationCacheHits;
+            return score;
+        }
+        ++context.evaluationCacheMisses;
+
+        if (const auto known = bitbaseEvaluation(context.board))
+            score = *known;
+        else if (context.shared.evaluator == Evaluator::Neural)
+            score = context.accumulators.evaluate(context.board);
+        else
+            score = staticEvaluation(context.board, context.pawnTable);
+        evaluationCache.store(key, score);
+        return score;
+    }
+
+    static int pieceValue(Chess::PieceType piece) {
+        return pieceWeights[static_cast<int>(piece)];
+    }
+
+    /**
+     * The material the player to move gains from a capture or promotion,
+     * before any recapture.
+     */
+    static int materialGain(const Chess::Move &move) {
+        int gain = move.dropPiece ? pieceValue(*move.dropPiece) : 0;
+        if (move.promotion)
+            gain += pieceValue(Chess::PieceType::Queen) - pieceValue(Chess::PieceType::Pawn);
+        return gain;
+    }
+
+    /**
+     * Static exchange evaluation: the material won or lost by a move when
+     * both sides keep recapturing on its target square with their least
+     * valuable attacker, and either side may stop when that is better for it.
+     * See https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+     */
+    static int staticExchange(const Chess::Board &board, const Chess::Move &move) {
+        // Least valuable pieces first
+        static constexpr Chess::PieceType attackerOrder[]{
+            Chess::PieceType::Pawn,
+            Chess::PieceType::Knight,
+            Chess::PieceType::Bishop,
+            Chess::PieceType::Rook,
+            Chess::PieceType::Queen,
+            Chess::PieceType::King,
+        };
+
+        int gain[32];
+        int depth = 0;
+
+        auto side = board.turnToMove();
+        auto attacker = board.pieceAt(move.from, side);
+        if (move.promotion)
+            attacker = Chess::PieceType::Queen;
+
+        auto occupiedSquares = board.teamOccupiedSquares(Chess::Color::White) |
+                               board.teamOccupiedSquares(Chess::Color::Black);
+        occupiedSquares.clearOccupancyAt(move.from);
+        if (move.dropSquare)
+            occupiedSquares.clearOccupancyAt(*move.dropSquare);
+
+        gain[0] = materialGain(move);
+
+        while (depth < 31) {
+            side = Chess::oppositeTeam(side);
+
+            const auto attackers = board.attackersTo(move.to, occupiedSquares) & occupiedSquares &
+                                   board.teamOccupiedSquares(side);
+            if (!attackers)
+                break;
+
+            Chess::Bitboard next;
+            for (auto piece: attackerOrder) {
+                next = attackers & board.pieces(side, piece);
+                if (next) {
+                    ++depth;
+                    // Speculative score of capturing the last attacker, if it is not recaptured
+                    gain[depth] = pieceValue(attacker) - gain[depth - 1];
+                    attacker = piece;
+                    break;
+                }
+            }
+
+            // Neither side can gain by continuing
+            if (std::max(-gain[depth - 1], gain[depth]) < 0)
+                break;
+
+            occupiedSquares.clearOccupancyAt(Chess::Square(next.bitScanForward()));
+        }
+
+        while (depth > 0) {
+            gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+            --depth;
+        }
+
+        return gain[0];
+    }
+
+    /**
+     * Most valuable victim, least valuable attacker: captures of valuable
+     * pieces first, and of those, captures with cheap pieces first.
+     */
+    static int mvvLva(const Chess::Board &board, const Chess::Move &move) {
+        return 16 * materialGain(move) - pieceValue(board.pieceAt(move.from, board.turnToMove())) / 100;
+    }
+
+    /**
+     * Pick the move with the highest ordering score among the moves from the
+     * given index on, and swap it to that index. Selecting the moves one at a
+     * time is cheaper than sorting, since most nodes cut off after a few moves.
+     */
+    static void pickMove(std::vector<Chess::Move> &moves, std::vector<int> &scores, std::size_t index) {
+        std::size_t best = index;
+        for (std::size_t i = index + 1; i < moves.size(); ++i) {
+            if (scores[i] > scores[best])
+                best = i;
+        }
+
+        std::swap(moves[index], moves[best]);
+        std::swap(scores[index], scores[best]);
+    }
+
+    /**
+     * Give every move of a node an ordering score: the best move from an
+     * earlier search of the position first, then captures by MVV-LVA, then
+     * killer moves, the counter-move to the previous move, and finally the
+     * other quiet moves by their history.
+     */
+    static void scoreMoves(const SearchContext &context, int ply, uint16_t hashMove, uint16_t previousMove,
+                           const std::vector<Chess::Move> &moves, std::vector<int> &scores) {
+        const auto &board = context.board;
+        const auto &history = context.history[static_cast<int>(board.turnToMove())];
+
+        const auto &killers = context.killers[ply];
+        const auto counterMove = context.counterMoves[previousMove & 63][previousMove >> 6];
+        const auto previousTarget = Chess::Square(previousMove >> 6);
+
+        for (const auto &move: moves) {
+            const auto encodedMove = encodeMove(move);
+
+            int score;
+            if (encodedMove == hashMove)
+                score = hashMoveScore;
+            else if (move.dropPiece || move.promotion)
+                score = captureScore + mvvLva(board, move) +
+                        (previousMove != 0 && move.to == previousTarget ? recaptureBonus : 0);
+            else if (encodedMove == killers[0])
+                score = killerScore + 1;
+            else if (encodedMove == killers[1])
+                score = killerScore;
+            else if (encodedMove == counterMove)
+                score = counterMoveScore;
+            else
+                score = history[static_cast<int>(move.from)][static_cast<int>(move.to)];
+
+            scores.push_back(score);
+        }
+    }
+
+    /**
+     * Update a history score towards the bonus, so that scores saturate at
+     * historyMax instead of growing without bound ("history gravity").
+     */
+    static void updateHistory(int &entry, int bonus) {
+        entry += bonus - entry * std::abs(bonus) / historyMax;
+    }
+
+    /**
+     * Reward a quiet move which caused a beta cutoff, and penalize the quiet
+     * moves searched before it, which failed to.
+     */
+    static void updateQuietHeuristics(SearchContext &context, int ply, int depth, const Chess::Move &move,
+                                      uint16_t previousMove, const uint16_t *quietMoves, int quietMoveCount) {
+        const auto encodedMove = encodeMove(move);
+
+        auto &killers = context.killers[ply];
+        if (killers[0] != encodedMove) {
+            killers[1] = killers[0];
+            killers[0] = encodedMove;
+        }
+
+        if (previousMove != 0)
+            context.counterMoves[previousMove & 63][previousMove >> 6] = encodedMove;
+
+        auto &history = context.history[static_cast<int>(context.board.turnToMove())];
+        const int bonus = std::min(depth * depth, 400);
+
+        updateHistory(history[static_cast<int>(move.from)][static_cast<int>(move.to)], bonus);
+        for (int i = 0; i < quietMoveCount; ++i)
+            updateHistory(history[quietMoves[i] & 63][quietMoves[i] >> 6], -bonus);
+    }
+
+    /**
+     * Late move reductions: once the moves most likely to be best have been
+     * searched, the remaining quiet moves are searched with reduced depth.
+     * See https://www.chessprogramming.org/Late_Move_Reductions
+     */
+    static int lateMoveReduction(const Chess::Move &move, int score, int depth, int moveNumber,
+                                 bool isPvNode, bool isInCheck) {
+        if (depth < reductionDepth || moveNumber < reductionMoveNumber || isInCheck ||
+            move.dropPiece || move.promotion || score >= counterMoveScore)
+            return 0;
+
+        int reduction = lateMoveReductions[std::min(depth, 63)][std::min(moveNumber, 63)];
+        if (isPvNode)
+            --reduction;
+
+        // Always leave at least one ply to search
+        return std::clamp(reduction, 0, depth - 2);
+    }
+
+    /**
+     * Whether the player to move has pieces other than pawns. Null move
+     * pruning is unsafe without them, since those endgames are often zugzwang.
+     */
+    static bool hasNonPawnMaterial(const Chess::Board &board) {
+        const auto color = board.turnToMove();
+        const auto kingAndPawns = board.pieces(color, Chess::PieceType::King) |
+                                  board.pieces(color, Chess::PieceType::Pawn);
+        return static_cast<bool>(board.teamOccupiedSquares(color) & ~kingAndPawns);
+    }
+
+    int negaMax(SearchContext &context, int depth, int ply, int alpha, int beta, int color,
+                uint16_t previousMove) {
+        auto &board = context.board;
+        countNode(context, ply);
+
+        context.pvStack[ply].clear();
+
+        if (depth <= 0 || ply >= maxPly)
+            return quiescence(context, ply, alpha, beta, color);
+
+        // A draw according to the bitbases needs no search
+        if (probeBitbases(board) == Bitbases::Result::Draw)
+            return 0;
+
+        // Right after a capture or pawn move, the tablebases know the result.
+        // Cursed wins and blessed losses are draws by the fifty move rule.
+        if (board.halfMoveClock() == 0) {
+            if (const auto wdl = Syzygy::probeWdl(board)) {
+                if (*wdl == Syzygy::Wdl::Win)
+                    return tablebaseWinValue - ply;
+                if (*wdl == Syzygy::Wdl::Loss)
+                    return -tablebaseWinValue + ply;
+                return static_cast<int>(*wdl);
+            }
+        }
+
+        const auto originalAlpha = alpha;
+
+        TranspositionEntry entry{};
+        const bool isHashHit = transpositionTable.probe(board.hash(), entry);
+        if constexpr (isCountingSearchStats) {
+            ++context.hashProbes;
+            context.hashHits += isHashHit;
         }
+        if (isHashHit && entry.depth >= depth) {
+            const auto score = scoreFromTable(entry.score, ply);
+            if (entry.bound == Bound::Exact ||
+                (entry.bound == Bound::Lower && score >= beta) ||
+                (entry.bound == Bound::Upper && score <= alpha))
+                return score;
+        }
+
+        const bool isPvNode = beta - alpha > 1;
+        const bool isInCheck = board.isInCheck();
+
+        // Null move pruning: if passing the turn still fails high, a real move
+        // will almost certainly fail high too. Not done twice in a row, i.e.
+        // right after a null move, which is passed on as the previous move 0.
+        // See https://www.chessprogramming.org/Null_Move_Pruning
+        if (!isPvNode && !isInCheck && depth >= nullMoveDepth && previousMove != 0 &&
+            hasNonPawnMaterial(board) && color * evaluate(context) >= beta) {
+            const int reduction = nullMoveReduction + depth / nullMoveDepthDivisor;
+
+            board.performNullMove();
+            const auto score = -negaMax(context, depth - 1 - reduction, ply + 1, -beta, -beta + 1, -color, 0);
+            board.undoNullMove();
+
+            if (context.isStopped)
+                return score;
+
+            // Mate scores from a null move search are not proven
+            if (score >= beta)
+                return score >= mateThreshold ? beta : score;
+        }
+
+        auto &moves = context.moveStack[ply];
+        moves.clear();
+        board.pseudoLegalMoves(moves);
+
+        auto &scores = context.scoreStack[ply];
+        scores.clear();
+        scoreMoves(context, ply, isHashHit ? entry.move : 0, previousMove, moves, scores);
+
+        // The attack information is copied, since testing some moves for
+        // legality has to make them, which discards the cached copy
+        const auto info = board.attackInfo();
+
+        int value = -infinity;
+        int legalMoves = 0;
+        uint16_t bestMove = 0;
+        const Chess::Move *bestQuietMove = nullptr;
+
+        // Quiet moves searched before the best one, whose history is lowered on a cutoff
+        std::array<uint16_t, 64> quietMoves;
+        int quietMoveCount = 0;
+
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            pickMove(moves, scores, i);
+            const auto &move = moves[i];
+
+            if (!board.isLegal(move, info))
+                continue;
+            ++legalMoves;
+
+            if (isAborted(context)) {
+                context.isStopped = true;
+                break;
+            }
+
+            const int reduction = lateMoveReduction(move, scores[i], depth, legalMoves, isPvNode, isInCheck);
+            const auto score = searchMove(context, move, depth, ply, alpha, beta, color, legalMoves == 1, reduction);
+
+            if (context.isStopped)
+                return value;
+
+            const bool isQuiet = !move.dropPiece && !move.promotion;
+
+            if (score > value) {
+                value = score;
+                bestMove = encodeMove(move);
+                bestQuietMove = isQuiet ? &move : nullptr;
+            }
+
+            if (isPvNode && score > alpha && score < beta)
+                updatePv(context, ply, move);
+
+            alpha = std::max(alpha, value);
+            if (alpha >= beta) {
+                if constexpr (isCountingSearchStats) {
+                    ++context.betaCutoffs;
+                    context.firstMoveCutoffs += legalMoves == 1;
+                }
+                break;
+            }
+
+            if (isQuiet && quietMoveCount < static_cast<int>(quietMoves.size()))
+                quietMoves[quietMoveCount++] = encodeMove(move);
+
+            if (legalMoves == 1 && canSplit(context, depth)) {
+                // Helpers need the remaining moves filtered to legal ones, since
+                // they do not have the attack information of this position,
+                // and in the order they should be searched
+                std::size_t last = i + 1;
+                for (std::size_t j = i + 1; j < moves.size(); ++j) {
+                    if (board.isLegal(moves[j], info)) {
+                        moves[last] = moves[j];
+                        scores[last] = scores[j];
+                        ++last;
+                    }
+                }
+                moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(last), moves.end());
+                scores.erase(scores.begin() + static_cast<std::ptrdiff_t>(last), scores.end());
+
+                for (std::size_t j = i + 1; j < moves.size(); ++j)
+                    pickMove(moves, scores, j);
+
+                // The ordering scores are not needed anymore, so they are replaced by the
+                // reductions, counting the moves as the loop above does: by legal moves searched
+                for (std::size_t j = i + 1; j < moves.size(); ++j) {
+                    scores[j] = lateMoveReduction(moves[j], scores[j], depth,
+                                                  legalMoves + static_cast<int>(j - i), isPvNode, isInCheck);
+                }
+
+                const int remaining = static_cast<int>(moves.size() - i - 1);
+                if (remaining == 0)
+                    break;
+                legalMoves += remaining;
+
+                const auto [splitValue, index] = split(context, moves.data() + i + 1, scores.data() + i + 1,
+                                                       remaining, depth, ply, color, alpha, beta, value);
+                if (index != -1) {
+                    const auto &splitMove = moves[i + 1 + index];
+                    value = splitValue;
+                    bestMove = encodeMove(splitMove);
+                    bestQuietMove = (!splitMove.dropPiece && !splitMove.promotion) ? &splitMove : nullptr;
+                }
+                break;
+            }
+        }
+
+        if (context.isStopped)
+            return value;
+
+        if (legalMoves == 0) {
+            // Checkmate or stalemate
+            return isInCheck ? -mateValue + ply : 0;
+        }
+
+        if (value >= beta && bestQuietMove)
+            updateQuietHeuristics(context, ply, depth, *bestQuietMove, previousMove, quietMoves.data(), quietMoveCount);
+
+        const auto bound = (value >= beta) ? Bound::Lower
+                                           : (value > originalAlpha) ? Bound::Exact : Bound::Upper;
+        transpositionTable.store(board.hash(), depth, scoreToTable(value, ply), bound, bestMove);
 
-        // return value
         return value;
     }
 
-    int staticEvaluation(const Chess::Board &chessBoard) {
-        int evaluation = 0;
+    /**
+     * Search captures and promotions only, until the position is quiet, so
+     * that positions in the middle of an exchange are not evaluated statically.
+     * The player to move can always stand pat, i.e. decline to capture, unless
+     * in check, in which case all moves are searched.
+     * See https://www.chessprogramming.org/Quiescence_Search
+     */
+    int quiescence(SearchContext &context, int ply, int alpha, int beta, int color) {
+        auto &board = context.board;
+        countNode(context, ply);
+        if constexpr (isCountingSearchStats)
+            ++context.quiescenceNodes;
+
+        if (ply >= maxPly)
+            return color * evaluate(context);
+
+        const bool isInCheck = board.isInCheck();
+
+        int value = -infinity;
+        int standPat = -infinity;
+
+        if (!isInCheck) {
+            standPat = color * evaluate(context);
+            if (standPat >= beta)
+                return standPat;
+
+            value = standPat;
+            alpha = std::max(alpha, standPat);
+        }
+
+        auto &moves = context.moveStack[ply];
+        moves.clear();
+        if (isInCheck)
+            board.pseudoLegalMoves(moves);
+        else
+            board.tacticalMoves(moves);
 
-        // Material count + modifiers
-        const auto whiteOccupiedSquares = chessBoard.teamOccupiedSquares(Chess::Color::White);
+        auto &scores = context.scoreStack[ply];
+        scores.clear();
+        for (const auto &move: moves)
+            scores.push_back(mvvLva(board, move));
 
-        const auto blackOccupiedSquares = chessBoard.teamOccupiedSquares(Chess::Color::Black);
+        // Only needed once there are moves to test, see negaMax for why it is copied
+        const auto info = board.attackInfo();
 
-        for (int j = 0; j < 64; ++j) {
-            const auto square = Chess::Square(j);
+        int legalMoves = 0;
 
-            if (whiteOccupiedSquares.isOccupiedAt(square)) {
-                auto piece = static_cast<int>(chessBoard.pieceAt(square, Chess::Color::White));
-                evaluation += (pieceWeights[piece] + positionWeights[0][piece][j]);
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            pickMove(moves, scores, i);
+            const auto &move = moves[i];
 
-            } else if (blackOccupiedSquares.isOccupiedAt(square)) {
-                auto piece = static_cast<int>(chessBoard.pieceAt(square, Chess::Color::Black));
-                evaluation -= (pieceWeights[piece] + positionWeights[1][piece][j]);
+            if (!isInCheck) {
+                // Delta pruning
+                if (!move.promotion && standPat + materialGain(move) + deltaMargin <= alpha)
+                    continue;
+
+                // Captures which lose material cannot improve on standing pat
+                if (staticExchange(board, move) < 0)
+                    continue;
+            }
+
+            if (!board.isLegal(move, info))
+                continue;
+            ++legalMoves;
+
+            if (isAborted(context)) {
+                context.isStopped = true;
+                break;
             }
+
+            board.performMove(move);
+            const auto score = -quiescence(context, ply + 1, -beta, -alpha, -color);
+            board.undoMove();
+
+            if (context.isStopped)
+                return value;
+
+            value = std::max(value, score);
+            alpha = std::max(alpha, value);
+            if (alpha >= beta)
+                break;
         }
 
-        return evaluation;
+        if (isInCheck && legalMoves == 0 && !context.isStopped)
+            return -mateValue + ply;
+
+        return value;
+    }
+
+    int staticEvaluation(const Chess::Board &chessBoard, PawnTable &pawnTable) {
+        return chessBoard.pieceSquareScore() + evaluatePawns(chessBoard, pawnTable);
     }
 }
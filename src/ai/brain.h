@@ -3,9 +3,343 @@
 #include <QPromise>
 
 #include "../chess/board.h"
-#include "node.h"
+#include "searchlimits.h"
+#include "book.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace Ai {
 
+    /**
+     * How often the static evaluation of a position was found in the evaluation cache.
+     */
+    struct EvaluationCacheStats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+    /**
+     * What a search did, for tuning and for spotting regressions. The nodes,
+     * depth, time and memory are always counted. The other counters are only
+     * counted when built with DEEPGREEN_SEARCH_STATS, since they cost some
+     * speed, and are 0 otherwise; see hasDetails.
+     */
+    struct SearchStats {
+        /**
+         * Positions visited by all threads, and those of them in quiescence search
+         */
+        uint64_t nodes{0};
+        uint64_t quiescenceNodes{0};
+
+        std::chrono::milliseconds time{0};
+
+        /**
+         * The last iteration the main thread completed, and the deepest ply any thread reached
+         */
+        int depth{0};
+        int selectiveDepth{0};
+
+        /**
+         * Nodes the main thread visited in its last completed iteration and in the one before
+         */
+        uint64_t lastIterationNodes{0};
+        uint64_t previousIterationNodes{0};
+
+        /**
+         * Nodes which failed high, and those of them which did so on their first move
+         */
+        uint64_t betaCutoffs{0};
+        uint64_t firstMoveCutoffs{0};
+
+        uint64_t hashProbes{0};
+        uint64_t hashHits{0};
+
+        /**
+         * Bytes used by the hash tables and the state of the search threads
+         */
+        std::size_t memory{0};
+
+        bool hasDetails{false};
+
+        [[nodiscard]]
+        uint64_t nodesPerSecond() const;
+
+        /**
+         * How many times more nodes the last iteration took than the one before
+         */
+        [[nodiscard]]
+        double branchingFactor() const;
+
+        /**
+         * The fractions from 0 to 1 of beta cutoffs on the first move, of hash
+         * probes which hit, and of nodes in quiescence search
+         */
+        [[nodiscard]]
+        double firstMoveCutoffRate() const;
+
+        [[nodiscard]]
+        double hashHitRate() const;
+
+        [[nodiscard]]
+        double quiescenceRate() const;
+    };
+
+    /**
+     * One of the best moves found by a search, with the play it expects to follow.
+     */
+    struct SearchLine {
+        /**
+         * Principal variation, starting with the move
+         */
+        std::vector<Chess::Move> pv;
+
+        /**
+         * Centipawns from the point of view of the side to move
+         */
+        int score{0};
+
+        /**
+         * Moves until mate, negative if the side to move gets mated, or 0 if no mate was found
+         */
+        int mate{0};
+
+        /**
+         * The iteration the line was completed in
+         */
+        int depth{0};
+    };
+
+    /**
+     * What a search has found so far, as of the last iteration it completed.
+     */
+    struct SearchProgress {
+        /**
+         * The best lines, best first, see setMultiPv; empty until the first iteration is completed
+         */
+        std::vector<SearchLine> lines;
+
+        int depth{0};
+
+        /**
+         * Positions visited by all threads so far, counted in steps of a thousand or so
+         */
+        uint64_t nodes{0};
+
+        std::chrono::milliseconds time{0};
+
+        /**
+         * Hash of the position searched, see Chess::Board::hash, so that the
+         * lines are not mistaken for those of another position
+         */
+        uint64_t key{0};
+    };
+
+    /**
+     * How threads share the work of a search.
+     */
+    enum class ParallelMode {
+        /**
+         * Every thread searches the whole tree, sharing results through the transposition table (Lazy SMP)
+         */
+        SharedHash,
+
+        /**
+         * Threads split the tree between them, searching siblings in parallel (Young Brothers Wait)
+         */
+        SplitPoint,
+    };
+
+    /**
+     * How positions are evaluated statically.
+     */
+    enum class Evaluator {
+        /**
+         * Hand-written terms: material, piece-square tables and pawn structure
+         */
+        Classical,
+
+        /**
+         * The loaded neural network, see Nnue
+         */
+        Neural,
+    };
+
+    /**
+     * Search for 15 seconds, unless the opening book has a move.
+     */
     void selectMove(QPromise<Chess::Move> &promise, const Chess::Board &board);
+
+    /**
+     * Search until the given depth has been completed.
+     */
+    void selectMoveToDepth(QPromise<Chess::Move> &promise, const Chess::Board &board, int depth);
+
+    void selectMoveWithLimits(QPromise<Chess::Move> &promise, const Chess::Board &board,
+                              const SearchLimits &limits);
+
+    /**
+     * Tell the running ponder search that the move it assumed was played, so
+     * that it continues as a normal search within its limits. Must only be
+     * called while a search with SearchLimits::ponder set is running.
+     */
+    void ponderHit();
+
+    /**
+     * Tell the running search to stop as if its time were up, so that it
+     * delivers the best move it has found so far. Ponder searches wait for
+     * the ponder hit first. Must only be called while a search is running.
+     */
+    void stopSearch();
+
+    /**
+     * The reply to its move which the last search expected, i.e. the second
+     * move of its principal variation, if it has one.
+     */
+    [[nodiscard]]
+    std::optional<Chess::Move> ponderMove();
+
+    /**
+     * Set the number of threads searching in parallel. Takes effect from the next search.
+     */
+    void setThreadCount(int count);
+
+    [[nodiscard]]
+    int threadCount();
+
+    /**
+     * Set how many of the best root moves searches find, each with its score
+     * and principal variation, see searchLines. After the best move, each
+     * line searches the root moves not in a line yet, sharing the hash table
+     * and move ordering, so K lines cost far less than K searches, but more
+     * than one line still takes time from finding the best move. Takes
+     * effect from the next search.
+     */
+    void setMultiPv(int count);
+
+    [[nodiscard]]
+    int multiPv();
+
+    /**
+     * Set how threads share the work of a search. Takes effect from the next search.
+     */
+    void setParallelMode(ParallelMode mode);
+
+    [[nodiscard]]
+    ParallelMode parallelMode();
+
+    /**
+     * The number of positions visited by all threads of the last search.
+     */
+    [[nodiscard]]
+    uint64_t nodeCount();
+
+    /**
+     * The best lines of the last iteration the last search completed, best
+     * first: as many as set by setMultiPv, or fewer if there are fewer legal
+     * moves. Empty if the move was played from the book or the tablebases.
+     */
+    [[nodiscard]]
+    std::vector<SearchLine> searchLines();
+
+    /**
+     * What the running search has found so far, or what the last search
+     * found once it is done. It is updated whenever the search completes an
+     * iteration, which the search also reports as the progress value of its
+     * promise, so that callers watching the future know when to look. The
+     * best move so far can be played at any time with stopSearch.
+     */
+    [[nodiscard]]
+    SearchProgress searchProgress();
+
+    /**
+     * Statistics of all threads of the last search.
+     */
+    [[nodiscard]]
+    SearchStats searchStats();
+
+    /**
+     * Resize the transposition table shared by all searches. Must not be called while a search is running.
+     */
+    void setHashSize(std::size_t megabytes);
+
+    [[nodiscard]]
+    std::size_t hashSize();
+
+    /**
+     * Clear the transposition table and the evaluation cache. Must not be called while a search is running.
+     */
+    void clearHash();
+
+    /**
+     * Resize the evaluation cache shared by all searches. Must not be called while a search is running.
+     */
+    void setEvaluationCacheSize(std::size_t megabytes);
+
+    [[nodiscard]]
+    std::size_t evaluationCacheSize();
+
+    /**
+     * Evaluation cache hits and misses of all threads of the last search.
+     */
+    [[nodiscard]]
+    EvaluationCacheStats evaluationCacheStats();
+
+    /**
+     * Load the weights of the neural network from a file, see Nnue::loadNetwork.
+     * Must not be called while a search is running.
+     */
+    bool loadNetwork(const std::string &path);
+
+    [[nodiscard]]
+    bool isNetworkLoaded();
+
+    /**
+     * Select how positions are evaluated. Searches fall back to the classical
+     * evaluation while no network is loaded. Must not be called while a search is running.
+     */
+    void setEvaluator(Evaluator evaluator);
+
+    [[nodiscard]]
+    Evaluator evaluator();
+
+    /**
+     * Open a Polyglot opening book, which searches consult before searching.
+     * Must not be called while a search is running.
+     */
+    bool openBook(const std::string &path);
+
+    /**
+     * Must not be called while a search is running.
+     */
+    void closeBook();
+
+    [[nodiscard]]
+    bool isBookOpen();
+
+    void setBookSelection(BookSelection selection);
+
+    [[nodiscard]]
+    BookSelection bookSelection();
+
+    /**
+     * Load the endgame bitbases found in a directory, see Bitbases::load, and
+     * generate the three-piece ones which are missing, which takes a moment.
+     * The result is the number of bitbases present. Searches do not probe the
+     * bitbases until it returns, so the first call may run in the background
+     * while searching; later calls must not be made while a search is running.
+     * Once canceled, the bitbases still missing are not generated.
+     */
+    void loadBitbases(QPromise<int> &promise, const std::string &directory);
+
+    /**
+     * Probe the Syzygy tablebases in a directory, or in several separated
+     * by ':' (';' on Windows), see Syzygy::setPath. Returns the number of
+     * endgames found. Must not be called while a search is running.
+     */
+    int setTablebasePath(const std::string &path);
 }
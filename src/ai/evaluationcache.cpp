@@ -0,0 +1,54 @@
+#include "evaluationcache.h"
+#include "../trace/perfcounters.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+
+namespace Ai {
+
+    EvaluationCache::EvaluationCache(std::size_t megabytes) {
+        resize(megabytes);
+    }
+
+    void EvaluationCache::resize(std::size_t megabytes) {
+        const std::size_t bytes = std::max<std::size_t>(megabytes, 1) * 1024 * 1024;
+        this->entryCount = std::bit_floor(bytes / sizeof(std::atomic<uint64_t>));
+        this->mask = this->entryCount - 1;
+        this->entries = std::make_unique<std::atomic<uint64_t>[]>(this->entryCount);
+        clear();
+    }
+
+    void EvaluationCache::clear() {
+        for (std::size_t i = 0; i < this->entryCount; ++i)
+            this->entries[i].store(0, std::memory_order_relaxed);
+    }
+
+    bool EvaluationCache::probe(uint64_t key, int &score) const {
+        PerfCounters::Scope scope(PerfCounters::Region::HashProbe);
+
+        const auto entry = this->entries[key & this->mask].load(std::memory_order_relaxed);
+
+        // An empty entry never matches, since stored entries are never 0
+        if (entry == 0 || (entry & ~scoreMask) != (key & ~scoreMask))
+            return false;
+
+        score = static_cast<int16_t>(entry & scoreMask);
+        return true;
+    }
+
+    void EvaluationCache::store(uint64_t key, int score) {
+        PerfCounters::Scope scope(PerfCounters::Region::HashProbe);
+
+        assert(score >= INT16_MIN && score <= INT16_MAX);
+
+        const auto entry = (key & ~scoreMask) | static_cast<uint16_t>(score);
+        if (entry != 0)
+            this->entries[key & this->mask].store(entry, std::memory_order_relaxed);
+    }
+
+    std::size_t EvaluationCache::size() const {
+        return this->entryCount * sizeof(std::atomic<uint64_t>) / (1024 * 1024);
+    }
+}
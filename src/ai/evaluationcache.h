@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Ai {
+
+    /**
+     * Fixed-size hash table of static evaluations, keyed by the Zobrist hash
+     * of the position, so that positions evaluated before, e.g. in an earlier
+     * iteration or a re-search, are not evaluated again. It is shared by all
+     * search threads without locks: an entry is a single word holding the
+     * upper bits of the key together with the score, so it is always read
+     * and written whole.
+     * See https://www.chessprogramming.org/Evaluation_Hash_Table
+     */
+    class EvaluationCache {
+    public:
+        static constexpr std::size_t defaultSize = 8;
+
+        explicit EvaluationCache(std::size_t megabytes = defaultSize);
+
+        EvaluationCache(const EvaluationCache &) = delete;
+
+        EvaluationCache &operator=(const EvaluationCache &) = delete;
+
+        /**
+         * Reallocate the cache. The size is rounded down to a power of two
+         * number of entries. Must not be called while a search is running.
+         */
+        void resize(std::size_t megabytes);
+
+        void clear();
+
+        [[nodiscard]]
+        bool probe(uint64_t key, int &score) const;
+
+        void store(uint64_t key, int score);
+
+        [[nodiscard]]
+        std::size_t size() const;
+
+    private:
+        /**
+         * The lower bits of an entry hold the score, the rest the matching bits of the key
+         */
+        static constexpr uint64_t scoreMask = 0xFFFF;
+
+        std::unique_ptr<std::atomic<uint64_t>[]> entries;
+        std::size_t entryCount{0};
+        std::size_t mask{0};
+    };
+}
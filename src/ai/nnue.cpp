@@ -0,0 +1,275 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace Ai::Nnue {
+
+    using Chess::Color;
+    using Chess::PieceType;
+    using Chess::Square;
+
+    static constexpr uint32_t fileVersion = 1;
+
+    /**
+     * Outputs of the hidden layers are scaled down by 2^weightShift, as their
+     * weights are fixed point numbers with that many fractional bits.
+     */
+    static constexpr int weightShift = 6;
+
+    /**
+     * The output of the network is this many times the score in centipawns.
+     */
+    static constexpr int outputScale = 16;
+
+    /**
+     * Scores of the network stay well clear of mate scores.
+     */
+    static constexpr int maxScore = 20000;
+
+    struct Network {
+        std::vector<int16_t> featureBiases = std::vector<int16_t>(halfDimensions);
+        std::vector<int16_t> featureWeights = std::vector<int16_t>(static_cast<std::size_t>(featureCount) * halfDimensions);
+
+        std::array<int32_t, hiddenDimensions> hidden1Biases{};
+        std::vector<int8_t> hidden1Weights = std::vector<int8_t>(hiddenDimensions * 2 * halfDimensions);
+
+        std::array<int32_t, hiddenDimensions> hidden2Biases{};
+        std::array<int8_t, hiddenDimensions * hiddenDimensions> hidden2Weights{};
+
+        int32_t outputBias{0};
+        std::array<int8_t, hiddenDimensions> outputWeights{};
+    };
+
+    static std::unique_ptr<const Network> network;
+
+    template<typename T>
+    static bool readValues(std::istream &stream, T *values, std::size_t count) {
+        stream.read(reinterpret_cast<char *>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(stream);
+    }
+
+    bool loadNetwork(const std::string &path) {
+        // The file is read straight into memory, which requires a little endian machine
+        if constexpr (std::endian::native != std::endian::little)
+            return false;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        char magic[4];
+        uint32_t version;
+        if (!readValues(file, magic, 4) || std::memcmp(magic, "DGNN", 4) != 0 ||
+            !readValues(file, &version, 1) || version != fileVersion)
+            return false;
+
+        auto loaded = std::make_unique<Network>();
+        if (!readValues(file, loaded->featureBiases.data(), loaded->featureBiases.size()) ||
+            !readValues(file, loaded->featureWeights.data(), loaded->featureWeights.size()) ||
+            !readValues(file, loaded->hidden1Biases.data(), loaded->hidden1Biases.size()) ||
+            !readValues(file, loaded->hidden1Weights.data(), loaded->hidden1Weights.size()) ||
+            !readValues(file, loaded->hidden2Biases.data(), loaded->hidden2Biases.size()) ||
+            !readValues(file, loaded->hidden2Weights.data(), loaded->hidden2Weights.size()) ||
+            !readValues(file, &loaded->outputBias, 1) ||
+            !readValues(file, loaded->outputWeights.data(), loaded->outputWeights.size()))
+            return false;
+
+        // Trailing data means the file was made for another architecture
+        if (file.peek() != std::ifstream::traits_type::eof())
+            return false;
+
+        network = std::move(loaded);
+        return true;
+    }
+
+    bool isNetworkLoaded() {
+        return static_cast<bool>(network);
+    }
+
+    static int orient(Color perspective, Square square) {
+        return (perspective == Color::White) ? static_cast<int>(square) : static_cast<int>(square) ^ 56;
+    }
+
+    static int featureIndex(Color perspective, Square king, Color color, PieceType piece, Square square) {
+        // Queens to pawns, the pieces of the perspective first
+        const int pieceIndex = (static_cast<int>(piece) - static_cast<int>(PieceType::Queen)) * 2 +
+                               (color == perspective ? 0 : 1);
+        return (orient(perspective, king) * 10 + pieceIndex) * 64 + orient(perspective, square);
+    }
+
+    static void addFeature(std::array<int16_t, halfDimensions> &values, int feature) {
+        const auto *weights = &network->featureWeights[static_cast<std::size_t>(feature) * halfDimensions];
+        for (int i = 0; i < halfDimensions; ++i)
+            values[i] = static_cast<int16_t>(values[i] + weights[i]);
+    }
+
+    static void removeFeature(std::array<int16_t, halfDimensions> &values, int feature) {
+        const auto *weights = &network->featureWeights[static_cast<std::size_t>(feature) * halfDimensions];
+        for (int i = 0; i < halfDimensions; ++i)
+            values[i] = static_cast<int16_t>(values[i] - weights[i]);
+    }
+
+    static void refresh(const Chess::Board &board, Color perspective, std::array<int16_t, halfDimensions> &values) {
+        std::copy(network->featureBiases.begin(), network->featureBiases.end(), values.begin());
+
+        const auto king = board.kingSquare(perspective);
+        for (const auto color: {Color::White, Color::Black}) {
+            for (int piece = static_cast<int>(PieceType::Queen); piece <= static_cast<int>(PieceType::Pawn); ++piece) {
+                for (auto pieces = board.pieces(color, PieceType(piece)); pieces;) {
+                    const auto square = pieces.popLowestSquare();
+                    addFeature(values, featureIndex(perspective, king, color, PieceType(piece), square));
+                }
+            }
+        }
+    }
+
+    static bool movesKing(const Chess::DirtyPieces &dirtyPieces, Color color) {
+        for (int i = 0; i < dirtyPieces.count; ++i) {
+            const auto &dirtyPiece = dirtyPieces.pieces[i];
+            if (dirtyPiece.piece == PieceType::King && dirtyPiece.color == color)
+                return true;
+        }
+        return false;
+    }
+
+    AccumulatorStack::AccumulatorStack(std::size_t size)
+            : accumulators(size) {}
+
+    void AccumulatorStack::update(const Chess::Board &board, std::size_t index, Accumulator &accumulator) {
+        for (const auto perspective: {Color::White, Color::Black}) {
+            auto &values = accumulator.values[static_cast<int>(perspective)];
+
+            // Look for the closest earlier position with a computed accumulator,
+            // which is only useful as long as the king has stayed on its square
+            const Accumulator *source = nullptr;
+            std::size_t sourceIndex = index;
+            for (std::size_t i = index; i-- > 0;) {
+                if (movesKing(board.dirtyPieces(i), perspective))
+                    break;
+                if (i < this->accumulators.size() && this->accumulators[i].key == board.hashBefore(i)) {
+                    source = &this->accumulators[i];
+                    sourceIndex = i;
+                    break;
+                }
+            }
+
+            if (!source) {
+                refresh(board, perspective, values);
+                continue;
+            }
+
+            values = source->values[static_cast<int>(perspective)];
+
+            const auto king = board.kingSquare(perspective);
+            for (std::size_t i = sourceIndex; i < index; ++i) {
+                const auto &dirtyPieces = board.dirtyPieces(i);
+                for (int j = 0; j < dirtyPieces.count; ++j) {
+                    const auto &dirtyPiece = dirtyPieces.pieces[j];
+
+                    // Kings are not features; only the enemy king can have moved here
+                    if (dirtyPiece.piece == PieceType::King)
+                        continue;
+
+                    if (dirtyPiece.from != Square::None)
+                        removeFeature(values, featureIndex(perspective, king, dirtyPiece.color, dirtyPiece.piece,
+                                                           dirtyPiece.from));
+                    if (dirtyPiece.to != Square::None)
+                        addFeature(values, featureIndex(perspective, king, dirtyPiece.color, dirtyPiece.piece,
+                                                        dirtyPiece.to));
+                }
+            }
+        }
+    }
+
+    /**
+     * The sum of the products of unsigned 8-bit inputs and signed 8-bit
+     * weights. The size must be a multiple of 32.
+     */
+    static int32_t dotProduct(const uint8_t *input, const int8_t *weights, int size) {
+#if defined(__AVX2__)
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < size; i += 32) {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i));
+            // Pairs of products fit in 16 bits, since the inputs are at most 127
+            const __m256i products = _mm256_maddubs_epi16(in, w);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+        return _mm_cvtsi128_si32(total);
+#elif defined(__SSSE3__)
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < size; i += 16) {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+            const __m128i products = _mm_maddubs_epi16(in, w);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < size; ++i)
+            sum += static_cast<int32_t>(input[i]) * weights[i];
+        return sum;
+#endif
+    }
+
+    /**
+     * A dense layer followed by a clipped ReLU, whose outputs are the inputs of the next layer.
+     */
+    static void denseLayer(const uint8_t *input, int inputs, const int8_t *weights, const int32_t *biases,
+                           int outputs, uint8_t *output) {
+        for (int i = 0; i < outputs; ++i) {
+            const int32_t value = biases[i] + dotProduct(input, weights + i * inputs, inputs);
+            output[i] = static_cast<uint8_t>(std::clamp(value >> weightShift, 0, 127));
+        }
+    }
+
+    int AccumulatorStack::evaluate(const Chess::Board &board) {
+        const auto index = board.historySize();
+        auto &accumulator = (index < this->accumulators.size()) ? this->accumulators[index] : this->overflow;
+        if (accumulator.key != board.hash() || &accumulator == &this->overflow) {
+            update(board, index, accumulator);
+            accumulator.key = board.hash();
+        }
+
+        // The side to move comes first
+        const auto us = board.turnToMove();
+        const auto &ourValues = accumulator.values[static_cast<int>(us)];
+        const auto &theirValues = accumulator.values[static_cast<int>(Chess::oppositeTeam(us))];
+
+        alignas(64) uint8_t transformed[2 * halfDimensions];
+        for (int i = 0; i < halfDimensions; ++i) {
+            transformed[i] = static_cast<uint8_t>(std::clamp<int>(ourValues[i], 0, 127));
+            transformed[halfDimensions + i] = static_cast<uint8_t>(std::clamp<int>(theirValues[i], 0, 127));
+        }
+
+        alignas(64) uint8_t hidden1[hiddenDimensions];
+        denseLayer(transformed, 2 * halfDimensions, network->hidden1Weights.data(), network->hidden1Biases.data(),
+                   hiddenDimensions, hidden1);
+
+        alignas(64) uint8_t hidden2[hiddenDimensions];
+        denseLayer(hidden1, hiddenDimensions, network->hidden2Weights.data(), network->hidden2Biases.data(),
+                   hiddenDimensions, hidden2);
+
+        const int32_t output = network->outputBias +
+                               dotProduct(hidden2, network->outputWeights.data(), hiddenDimensions);
+        const int score = std::clamp(output / outputScale, -maxScore, maxScore);
+
+        return (us == Color::White) ? score : -score;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../chess/board.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Efficiently updatable neural network evaluation. The first layer, the
+ * feature transformer, is by far the largest, but its input changes by only
+ * a few features per move, so its output is kept up to date incrementally in
+ * accumulators. The small layers after it are computed in full with integer
+ * arithmetic, using AVX2 or SSSE3 where the build targets them.
+ * See https://www.chessprogramming.org/NNUE
+ */
+namespace Ai::Nnue {
+
+    /**
+     * HalfKP features: the square of a king, combined with the kind, color
+     * and square of one of the other pieces, kings excluded. The features of
+     * black are seen from black's side of the board, so that both colors
+     * share the same weights.
+     */
+    inline constexpr int featureCount = 64 * 10 * 64;
+
+    /**
+     * Outputs of the feature transformer for each color, and of the hidden layers
+     */
+    inline constexpr int halfDimensions = 256;
+    inline constexpr int hiddenDimensions = 32;
+
+    struct alignas(64) Accumulator {
+        /**
+         * Feature transformer output from the point of view of each color, indexed by the Color enum
+         */
+        std::array<std::array<int16_t, halfDimensions>, 2> values;
+
+        /**
+         * Hash of the position the accumulator was computed for, or 0 if none
+         */
+        uint64_t key{0};
+    };
+
+    /**
+     * Load the weights of a network from a file, replacing the current
+     * network if successful. Must not be called while a search is running.
+     *
+     * <p> The file holds, in order and in little endian: the magic bytes
+     * "DGNN", a 32-bit version number (1), then for the feature transformer
+     * 256 16-bit biases and 40960 x 256 16-bit weights, then for each of the
+     * two hidden layers 32 32-bit biases and 32 x 512 and 32 x 32 8-bit
+     * weights respectively, and for the output 1 32-bit bias and 32 8-bit
+     * weights. Weights of the dense layers are stored row by row, one row per
+     * output.
+     */
+    bool loadNetwork(const std::string &path);
+
+    [[nodiscard]]
+    bool isNetworkLoaded();
+
+    /**
+     * The accumulators of one search thread, one for each position on the
+     * path from the root, indexed by the history size of the board. The
+     * accumulator of a position is computed from that of an earlier position
+     * on the path by applying the pieces changed by the moves in between,
+     * and only computed from scratch when a king has moved.
+     */
+    class AccumulatorStack {
+    public:
+        explicit AccumulatorStack(std::size_t size);
+
+        /**
+         * Evaluate a position from white's point of view. A network must be loaded.
+         */
+        [[nodiscard]]
+        int evaluate(const Chess::Board &board);
+
+    private:
+        std::vector<Accumulator> accumulators;
+
+        /**
+         * Used for positions deeper than the stack
+         */
+        Accumulator overflow;
+
+        void update(const Chess::Board &board, std::size_t index, Accumulator &accumulator);
+    };
+}
@@ -0,0 +1,161 @@
+#include "pawns.h"
+
+#include "../chess/psqt.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Ai {
+
+    using Chess::Bitboard;
+    using Chess::Color;
+    using Chess::Direction;
+    using Chess::PieceType;
+    using Chess::Psqt::makeScore;
+
+    static constexpr int doubledPenalty = makeScore(-10, -20);
+    static constexpr int isolatedPenalty = makeScore(-10, -15);
+    static constexpr int backwardPenalty = makeScore(-8, -10);
+
+    /**
+     * Bonus for a passed pawn, indexed by its rank counted from its own side of the board
+     */
+    static constexpr int passedBonus[8]{
+        makeScore(0, 0),
+        makeScore(5, 10),
+        makeScore(5, 15),
+        makeScore(10, 25),
+        makeScore(20, 45),
+        makeScore(35, 75),
+        makeScore(60, 120),
+        makeScore(0, 0),
+    };
+
+    /**
+     * Bonus for each pawn on the first and second rank in front of its king
+     * and the files next to it. A shield only matters while there are pieces
+     * left to attack the king.
+     */
+    static constexpr int shieldBonus[2]{
+        makeScore(10, 0),
+        makeScore(5, 0),
+    };
+
+    template<Color color>
+    struct PawnDirections {
+        static constexpr Direction forward = (color == Color::White) ? Direction::North : Direction::South;
+        static constexpr Direction backward = (color == Color::White) ? Direction::South : Direction::North;
+        static constexpr Direction forwardEast = (color == Color::White) ? Direction::NorthEast : Direction::SouthEast;
+        static constexpr Direction forwardWest = (color == Color::White) ? Direction::NorthWest : Direction::SouthWest;
+    };
+
+    template<Color color>
+    static Bitboard pawnAttacks(Bitboard pawns) {
+        using Directions = PawnDirections<color>;
+        return pawns.shifted<Directions::forwardEast>() | pawns.shifted<Directions::forwardWest>();
+    }
+
+    /**
+     * The squares in front of the pawns, on their own files
+     */
+    template<Color color>
+    static Bitboard frontSpans(Bitboard pawns) {
+        using Directions = PawnDirections<color>;
+        const Bitboard front = pawns.shifted<Directions::forward>();
+        return front.filled<Directions::forward>();
+    }
+
+    /**
+     * The squares behind the pawns, on their own files
+     */
+    template<Color color>
+    static Bitboard rearSpans(Bitboard pawns) {
+        using Directions = PawnDirections<color>;
+        const Bitboard rear = pawns.shifted<Directions::backward>();
+        return rear.filled<Directions::backward>();
+    }
+
+    template<Color color>
+    static int evaluatePawnStructure(const Chess::Board &board) {
+        using Directions = PawnDirections<color>;
+        constexpr auto enemyColor = Chess::oppositeTeam(color);
+
+        const Bitboard pawns = board.pieces(color, PieceType::Pawn);
+        const Bitboard enemyPawns = board.pieces(enemyColor, PieceType::Pawn);
+
+        int score = 0;
+
+        // Pawns with another pawn of the same color in front of them
+        const Bitboard doubled = pawns & rearSpans<color>(pawns);
+        score += doubledPenalty * doubled.populationCount();
+
+        // Pawns without pawns of the same color on the files next to them
+        const Bitboard files = pawns.filled<Direction::North>() | pawns.filled<Direction::South>();
+        const Bitboard isolated = pawns & ~(files.shifted<Direction::East>() | files.shifted<Direction::West>());
+        score += isolatedPenalty * isolated.populationCount();
+
+        // Pawns which cannot advance safely, and which the pawns next to them
+        // cannot defend, since they have already advanced further
+        // See https://www.chessprogramming.org/Backward_Pawns_(Bitboards)
+        const Bitboard attacks = pawnAttacks<color>(pawns);
+        const Bitboard defendedSquares = attacks.filled<Directions::forward>();
+        const Bitboard stops = pawns.shifted<Directions::forward>();
+        const Bitboard unsafeStops = stops & pawnAttacks<enemyColor>(enemyPawns) & ~defendedSquares;
+        const Bitboard backward = unsafeStops.shifted<Directions::backward>();
+        score += backwardPenalty * backward.populationCount();
+
+        // Pawns which no enemy pawn can block or capture on their way to promotion;
+        // of doubled pawns, only the front one counts
+        const Bitboard enemySpans = frontSpans<enemyColor>(enemyPawns);
+        const Bitboard stoppable = enemySpans | enemySpans.shifted<Direction::East>() |
+                               enemySpans.shifted<Direction::West>();
+        for (auto passed = pawns & ~stoppable & ~rearSpans<color>(pawns); passed;) {
+            const int rank = static_cast<int>(passed.popLowestSquare()) / 8;
+            score += passedBonus[(color == Color::White) ? rank : 7 - rank];
+        }
+
+        return score;
+    }
+
+    template<Color color>
+    static int evaluatePawnShield(const Chess::Board &board) {
+        using Directions = PawnDirections<color>;
+
+        const Bitboard king = board.pieces(color, PieceType::King);
+        const Bitboard pawns = board.pieces(color, PieceType::Pawn);
+
+        const Bitboard kingFiles = king | king.shifted<Direction::East>() | king.shifted<Direction::West>();
+        const Bitboard firstRank = kingFiles.shifted<Directions::forward>();
+        const Bitboard secondRank = firstRank.shifted<Directions::forward>();
+
+        return shieldBonus[0] * (pawns & firstRank).populationCount() +
+               shieldBonus[1] * (pawns & secondRank).populationCount();
+    }
+
+    PawnTable::PawnTable(std::size_t entries)
+            : entries(std::bit_floor(std::max<std::size_t>(entries, 1))),
+              mask(this->entries.size() - 1) {}
+
+    std::size_t PawnTable::byteSize() const {
+        return this->entries.size() * sizeof(Entry);
+    }
+
+    int PawnTable::pawnStructure(const Chess::Board &board) {
+        const auto key = board.pawnHash();
+
+        // Empty entries have the key of positions without pawns, whose score is 0 as well
+        auto &entry = this->entries[key & this->mask];
+        if (entry.key != key) {
+            entry.key = key;
+            entry.score = evaluatePawnStructure<Color::White>(board) - evaluatePawnStructure<Color::Black>(board);
+        }
+
+        return entry.score;
+    }
+
+    int evaluatePawns(const Chess::Board &board, PawnTable &table) {
+        const int score = table.pawnStructure(board) +
+                          evaluatePawnShield<Color::White>(board) - evaluatePawnShield<Color::Black>(board);
+        return Chess::Psqt::taperedValue(score, board.gamePhase());
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../chess/board.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ai {
+
+    /**
+     * Cache of pawn structure scores, keyed by the pawn hash of the position.
+     * The pawn structure rarely changes between nodes close to each other in
+     * the tree, so almost every lookup hits. Every search thread has its own
+     * table, so no synchronisation is needed.
+     * See https://www.chessprogramming.org/Pawn_Hash_Table
+     */
+    class PawnTable {
+    public:
+        static constexpr std::size_t defaultEntries = 16384;
+
+        explicit PawnTable(std::size_t entries = defaultEntries);
+
+        /**
+         * The packed middlegame and endgame score of the pawn structure from
+         * white's point of view, see Chess::Psqt::makeScore.
+         */
+        [[nodiscard]]
+        int pawnStructure(const Chess::Board &board);
+
+        [[nodiscard]]
+        std::size_t byteSize() const;
+
+    private:
+        struct Entry {
+            uint64_t key{0};
+            int score{0};
+        };
+
+        std::vector<Entry> entries;
+        std::size_t mask;
+    };
+
+    /**
+     * Evaluate doubled, isolated, backward and passed pawns, and the pawn
+     * shields in front of the kings, from white's point of view. Everything
+     * but the shields, which depend on where the kings are, comes from the table.
+     */
+    [[nodiscard]]
+    int evaluatePawns(const Chess::Board &board, PawnTable &table);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace Ai {
+
+    /**
+     * What bounds a search. Limits which are zero are not used, and a search
+     * without any limits runs until it is canceled.
+     */
+    struct SearchLimits {
+        /**
+         * Fixed time to spend on the move; takes precedence over the clock
+         */
+        std::chrono::milliseconds moveTime{0};
+
+        /**
+         * Time left on the clock of the player to move, and the time added to it after every move
+         */
+        std::chrono::milliseconds time{0};
+        std::chrono::milliseconds increment{0};
+
+        /**
+         * Moves left until the next time control, or 0 if the clock covers the rest of the game
+         */
+        int movesToGo{0};
+
+        int depth{0};
+
+        uint64_t nodes{0};
+
+        /**
+         * Ignore all other limits, and search until canceled
+         */
+        bool infinite{false};
+
+        /**
+         * Search without limits until ponderHit is called, i.e. while the
+         * opponent thinks about the move the search assumes was played; from
+         * then on the other limits apply, with time counted from the hit.
+         * The search never returns a move before the hit.
+         */
+        bool ponder{false};
+    };
+}
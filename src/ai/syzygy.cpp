@@ -0,0 +1,1241 @@
+#include "syzygy.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Ai::Syzygy {
+
+    using Chess::Bitboard;
+    using Chess::Color;
+    using Chess::PieceType;
+
+    static constexpr uint8_t wdlMagic[4]{0x71, 0xE8, 0x23, 0x5D};
+    static constexpr uint8_t dtzMagic[4]{0xD7, 0x66, 0x0C, 0xA5};
+
+    /**
+     * Flags in the first byte of a file
+     */
+    static constexpr uint8_t splitFlag = 1;
+    static constexpr uint8_t hasPawnsFlag = 2;
+
+    /**
+     * Flags of each compressed table in a file
+     */
+    static constexpr uint8_t sideToMoveFlag = 1;
+    static constexpr uint8_t mappedFlag = 2;
+    static constexpr uint8_t winPliesFlag = 4;
+    static constexpr uint8_t lossPliesFlag = 8;
+    static constexpr uint8_t wideFlag = 16;
+    static constexpr uint8_t singleValueFlag = 128;
+
+    static uint16_t readLittleEndian16(const uint8_t *data) {
+        return static_cast<uint16_t>(data[0] | data[1] << 8);
+    }
+
+    static uint32_t readLittleEndian32(const uint8_t *data) {
+        return static_cast<uint32_t>(readLittleEndian16(data)) |
+               static_cast<uint32_t>(readLittleEndian16(data + 2)) << 16;
+    }
+
+    static uint32_t readBigEndian32(const uint8_t *data) {
+        return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 |
+               static_cast<uint32_t>(data[2]) << 8 | static_cast<uint32_t>(data[3]);
+    }
+
+    static uint64_t readBigEndian64(const uint8_t *data) {
+        return static_cast<uint64_t>(readBigEndian32(data)) << 32 | readBigEndian32(data + 4);
+    }
+
+    /**
+     * Positive above the a1-h8 diagonal, negative below and 0 on it
+     */
+    static int offDiagonal(int square) {
+        return square / 8 - square % 8;
+    }
+
+    /**
+     * Tables used to turn the squares of the pieces into the index of a
+     * position, which only depend on the format.
+     */
+    struct Indices {
+        Indices();
+
+        /**
+         * The 28 squares below the a1-h8 diagonal
+         */
+        int b1h1h7[64]{};
+
+        /**
+         * The 10 squares of the a1-d1-d4 triangle, those on the diagonal last
+         */
+        int a1d1d4[64]{};
+
+        /**
+         * The 462 placements of two kings, the first in the a1-d1-d4 triangle
+         */
+        int kingPairs[10][64]{};
+
+        uint64_t binomial[maxPieces][64]{};
+
+        /**
+         * The a2-h7 squares from 47 down to 0, towards the centre and up the
+         * board, so that the leading pawn is the one with the highest number.
+         */
+        int pawns[64]{};
+
+        int leadPawnIndex[6][64]{};
+        int leadPawnsSize[6][4]{};
+    };
+
+    Indices::Indices() {
+        int code = 0;
+        for (int square = 0; square < 64; ++square) {
+            if (offDiagonal(square) < 0)
+                this->b1h1h7[square] = code++;
+        }
+
+        std::vector<int> diagonal;
+        code = 0;
+        for (int square = 0; square <= static_cast<int>(Chess::Square::D4); ++square) {
+            if (offDiagonal(square) < 0 && square % 8 <= 3)
+                this->a1d1d4[square] = code++;
+            else if (offDiagonal(square) == 0 && square % 8 <= 3)
+                diagonal.push_back(square);
+        }
+        for (const auto square: diagonal)
+            this->a1d1d4[square] = code++;
+
+        // With the first king on the diagonal, the second is not above it, and
+        // placements with both on the diagonal come last
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int index = 0; index < 10; ++index) {
+            for (int first = 0; first <= static_cast<int>(Chess::Square::D4); ++first) {
+                if (this->a1d1d4[first] != index || (index == 0 && first != static_cast<int>(Chess::Square::B1)))
+                    continue;
+
+                const auto near = Chess::Board::kingAttacks(Chess::Square(first)) | Bitboard(Chess::Square(first));
+                for (int second = 0; second < 64; ++second) {
+                    if (near.isOccupiedAt(Chess::Square(second)) ||
+                        (offDiagonal(first) == 0 && offDiagonal(second) > 0))
+                        continue;
+
+                    if (offDiagonal(first) == 0 && offDiagonal(second) == 0)
+                        bothOnDiagonal.emplace_back(index, second);
+                    else
+                        this->kingPairs[index][second] = code++;
+                }
+            }
+        }
+        for (const auto &[index, second]: bothOnDiagonal)
+            this->kingPairs[index][second] = code++;
+
+        this->binomial[0][0] = 1;
+        for (int n = 1; n < 64; ++n) {
+            for (int k = 0; k < maxPieces && k <= n; ++k)
+                this->binomial[k][n] = (k > 0 ? this->binomial[k - 1][n - 1] : 0) +
+                                       (k < n ? this->binomial[k][n - 1] : 0);
+        }
+
+        int available = 47;
+        for (int leadPawns = 1; leadPawns <= 5; ++leadPawns) {
+            for (int file = 0; file < 4; ++file) {
+                int index = 0;
+                for (int rank = 1; rank <= 6; ++rank) {
+                    const int square = 8 * rank + file;
+                    if (leadPawns == 1) {
+                        this->pawns[square] = available--;
+                        this->pawns[square ^ 7] = available--;
+                    }
+                    this->leadPawnIndex[leadPawns][square] = index;
+                    index += static_cast<int>(this->binomial[leadPawns - 1][this->pawns[square]]);
+                }
+                this->leadPawnsSize[leadPawns][file] = index;
+            }
+        }
+    }
+
+    static const Indices &indices() {
+        static const Indices instance;
+        return instance;
+    }
+
+    /**
+     * One compressed table: the values of all positions with one side to
+     * move, and with pawns one file of the leading pawn. Values are
+     * compressed by recursive pairing, where symbols stand for pairs of
+     * symbols, and the symbols are then Huffman coded in fixed size blocks.
+     * See http://www.larsson.dogma.net/dcc99.pdf
+     */
+    struct PairsData {
+        uint8_t flags{0};
+
+        /**
+         * Lengths in bits of the Huffman codes. The minimum is the value of
+         * every position in a table with only one.
+         */
+        uint8_t minSymbolLength{0};
+        uint8_t maxSymbolLength{0};
+
+        uint64_t blockSize{0};
+        uint32_t blockCount{0};
+
+        /**
+         * The values of positions with an index of k * span + span / 2 are
+         * located directly through sparse index entry k.
+         */
+        uint64_t span{0};
+
+        const uint8_t *sparseIndex{nullptr};
+        uint64_t sparseIndexSize{0};
+
+        /**
+         * The number of values in each block, minus one
+         */
+        const uint8_t *blockLengths{nullptr};
+        uint64_t blockLengthsSize{0};
+
+        const uint8_t *lowestSymbols{nullptr};
+
+        /**
+         * The pair each symbol stands for, 12 bits each, with 0xFFF as the
+         * right one of a symbol standing for a value
+         */
+        const uint8_t *pairs{nullptr};
+
+        const uint8_t *data{nullptr};
+        const uint8_t *end{nullptr};
+
+        /**
+         * The lowest Huffman code of each length, left aligned
+         */
+        std::vector<uint64_t> base;
+
+        /**
+         * The number of values each symbol stands for, minus one
+         */
+        std::vector<uint8_t> symbolLengths;
+
+        /**
+         * The pieces in the order of their squares in the index
+         */
+        uint8_t pieces[maxPieces]{};
+
+        /**
+         * The pieces form groups of equal pieces, each contributing
+         * groupIndex times its placement to the index of a position
+         */
+        int groupLength[maxPieces + 1]{};
+        uint64_t groupIndex[maxPieces + 1]{};
+
+        /**
+         * Where the DTZ value maps for each result begin
+         */
+        uint16_t mapIndex[4]{};
+    };
+
+    /**
+     * A WDL or DTZ file, mapped when a position it covers is first probed.
+     */
+    struct TableFile {
+        std::string path;
+
+        std::atomic<bool> isReady{false};
+        bool isValid{false};
+
+        QFile file;
+
+        /**
+         * Indexed by side to move, which DTZ files only have one of, and by the file of the leading pawn
+         */
+        PairsData tables[2][4];
+
+        /**
+         * Values of DTZ tables, mapped from the stored ones
+         */
+        const uint8_t *map{nullptr};
+        uint64_t mapSize{0};
+    };
+
+    /**
+     * An endgame, with white as the side listed first in its name.
+     */
+    struct Table {
+        uint64_t key{0};
+
+        /**
+         * The key with the colors swapped, equal to key for symmetric material
+         */
+        uint64_t key2{0};
+
+        int pieceCount{0};
+        bool hasPawns{false};
+
+        /**
+         * Some side has a single piece of some kind besides the king
+         */
+        bool hasUniquePieces{false};
+
+        /**
+         * Pawns of the leading side, the one with fewer pawns but some, and of the other side
+         */
+        int pawnCount[2]{};
+
+        TableFile wdl;
+        TableFile dtz;
+    };
+
+    using Material = std::array<std::array<int, 6>, 2>;
+
+    /**
+     * The number of pieces of each kind, 4 bits each, from the pieces of
+     * the given side first.
+     */
+    static uint64_t materialKey(const Material &material, Color first) {
+        uint64_t key = 0;
+        for (int side = 0; side < 2; ++side) {
+            for (int type = 0; type < 6; ++type)
+                key |= static_cast<uint64_t>(material[side ^ static_cast<int>(first)][type]) << (4 * (6 * side + type));
+        }
+        return key;
+    }
+
+    static Material material(const Chess::Board &board) {
+        Material material{};
+        for (const auto color: {Color::White, Color::Black}) {
+            for (int type = 0; type < 6; ++type)
+                material[static_cast<int>(color)][type] = board.pieces(color, PieceType(type)).populationCount();
+        }
+        return material;
+    }
+
+    /**
+     * Piece codes of the format: 1 to 6 for white pawns, knights, bishops,
+     * rooks, queens and kings, and 9 to 14 for black ones.
+     */
+    static uint8_t pieceCode(Color color, PieceType type) {
+        static constexpr uint8_t codes[6]{6, 5, 4, 3, 2, 1};
+        return codes[static_cast<int>(type)] | (color == Color::Black ? 8 : 0);
+    }
+
+    static std::vector<std::unique_ptr<Table>> tables;
+    static std::unordered_map<uint64_t, Table *> tablesByKey;
+    static int largestPieceCount = 0;
+
+    static std::mutex mappingMutex;
+
+    /**
+     * Advance past a number of elements, failing if the file ends first.
+     */
+    static bool skip(const uint8_t *&data, const uint8_t *end, uint64_t count, uint64_t size) {
+        if (data > end || count > static_cast<uint64_t>(end - data) / size)
+            return false;
+        data += count * size;
+        return true;
+    }
+
+    static const uint8_t *wordAligned(const uint8_t *data) {
+        return data + (reinterpret_cast<uintptr_t>(data) & 1);
+    }
+
+    static int leftSymbol(const uint8_t *pairs, int symbol) {
+        const auto *pair = pairs + 3 * symbol;
+        return (pair[1] & 0xF) << 8 | pair[0];
+    }
+
+    static int rightSymbol(const uint8_t *pairs, int symbol) {
+        const auto *pair = pairs + 3 * symbol;
+        return pair[2] << 4 | pair[1] >> 4;
+    }
+
+    /**
+     * Split the pieces into groups and work out what each group is worth in
+     * the index. The first group holds the leading pawns, or the kings
+     * together with a unique piece if there is one, and the other groups
+     * are runs of equal pieces. The groups contribute to the index in the
+     * order given by the file, the leading group at order[0] and the pawns
+     * of the other side at order[1].
+     */
+    static bool setGroups(const Table &table, PairsData &data, const int order[2], int file) {
+        const auto &ix = indices();
+
+        int count = 0;
+        int firstLength = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+        data.groupLength[count] = 1;
+        for (int i = 1; i < table.pieceCount; ++i) {
+            if (--firstLength > 0 || data.pieces[i] == data.pieces[i - 1])
+                ++data.groupLength[count];
+            else
+                data.groupLength[++count] = 1;
+        }
+        data.groupLength[++count] = 0;
+
+        const bool pawnsOnBothSides = table.hasPawns && table.pawnCount[1] > 0;
+        if (table.hasPawns && (data.groupLength[0] > 5 || (pawnsOnBothSides && count < 2)))
+            return false;
+
+        int next = pawnsOnBothSides ? 2 : 1;
+        int freeSquares = 64 - data.groupLength[0] - (pawnsOnBothSides ? data.groupLength[1] : 0);
+        uint64_t index = 1;
+
+        for (int k = 0; next < count || k == order[0] || k == order[1]; ++k) {
+            if (k == order[0]) {
+                data.groupIndex[0] = index;
+                index *= table.hasPawns ? ix.leadPawnsSize[data.groupLength[0]][file]
+                                        : table.hasUniquePieces ? 31332 : 462;
+            } else if (k == order[1]) {
+                data.groupIndex[1] = index;
+                index *= ix.binomial[data.groupLength[1]][48 - data.groupLength[0]];
+            } else {
+                data.groupIndex[next] = index;
+                index *= ix.binomial[data.groupLength[next]][freeSquares];
+                freeSquares -= data.groupLength[next++];
+            }
+        }
+
+        data.groupIndex[count] = index;
+        return true;
+    }
+
+    /**
+     * Read the parameters of a compressed table and set up the Huffman
+     * decoding, returning where the next one starts.
+     */
+    static const uint8_t *setSizes(PairsData &data, const uint8_t *pointer, const uint8_t *end) {
+        if (end - pointer < 2)
+            return nullptr;
+
+        data.flags = *pointer++;
+        data.end = end;
+
+        if (data.flags & singleValueFlag) {
+            data.minSymbolLength = *pointer++;
+            return pointer;
+        }
+
+        if (end - pointer < 9)
+            return nullptr;
+
+        uint64_t size = 0;
+        for (int i = 0; i <= maxPieces; ++i) {
+            if (data.groupLength[i] == 0) {
+                size = data.groupIndex[i];
+                break;
+            }
+        }
+
+        if (pointer[0] >= 32 || pointer[1] >= 32)
+            return nullptr;
+        data.blockSize = uint64_t{1} << pointer[0];
+        data.span = uint64_t{1} << pointer[1];
+        data.sparseIndexSize = (size + data.span - 1) / data.span;
+        const int padding = pointer[2];
+        data.blockCount = readLittleEndian32(pointer + 3);
+        data.blockLengthsSize = static_cast<uint64_t>(data.blockCount) + padding;
+        data.maxSymbolLength = pointer[7];
+        data.minSymbolLength = pointer[8];
+        pointer += 9;
+
+        if (data.minSymbolLength < 1 || data.maxSymbolLength < data.minSymbolLength || data.maxSymbolLength > 63)
+            return nullptr;
+
+        data.lowestSymbols = pointer;
+        const int lengths = data.maxSymbolLength - data.minSymbolLength + 1;
+        if (!skip(pointer, end, lengths, 2))
+            return nullptr;
+
+        // Canonical Huffman codes: longer codes have lower values, and the
+        // codes of each length are consecutive, so the length of a code is
+        // found by comparing it with the lowest code of each length
+        // See https://en.wikipedia.org/wiki/Canonical_Huffman_code
+        data.base.assign(lengths, 0);
+        for (int i = lengths - 2; i >= 0; --i)
+            data.base[i] = (data.base[i + 1] + readLittleEndian16(data.lowestSymbols + 2 * i) -
+                            readLittleEndian16(data.lowestSymbols + 2 * (i + 1))) / 2;
+        for (int i = 0; i < lengths; ++i)
+            data.base[i] <<= 64 - i - data.minSymbolLength;
+
+        if (end - pointer < 2)
+            return nullptr;
+        const int symbolCount = readLittleEndian16(pointer);
+        pointer += 2;
+
+        data.pairs = pointer;
+        if (!skip(pointer, end, 3 * static_cast<uint64_t>(symbolCount) + (symbolCount & 1), 1))
+            return nullptr;
+
+        for (int symbol = 0; symbol < symbolCount; ++symbol) {
+            if (rightSymbol(data.pairs, symbol) != 0xFFF &&
+                (leftSymbol(data.pairs, symbol) >= symbolCount || rightSymbol(data.pairs, symbol) >= symbolCount))
+                return nullptr;
+        }
+
+        // A symbol standing for a pair is longer than both halves, unless
+        // the pairs form a cycle, which would never expand into a value
+        enum class Visit : uint8_t {
+            None,
+            Started,
+            Done,
+        };
+        data.symbolLengths.assign(symbolCount, 0);
+        std::vector<Visit> visits(symbolCount, Visit::None);
+        const auto setLength = [&](auto &self, int symbol) -> bool {
+            visits[symbol] = Visit::Started;
+            const int right = rightSymbol(data.pairs, symbol);
+            if (right != 0xFFF) {
+                const int left = leftSymbol(data.pairs, symbol);
+                for (const int half: {left, right}) {
+                    if (visits[half] == Visit::Started || (visits[half] == Visit::None && !self(self, half)))
+                        return false;
+                }
+                if (data.symbolLengths[left] + data.symbolLengths[right] + 1 > 0xFF)
+                    return false;
+                data.symbolLengths[symbol] = data.symbolLengths[left] + data.symbolLengths[right] + 1;
+            }
+            visits[symbol] = Visit::Done;
+            return true;
+        };
+        for (int symbol = 0; symbol < symbolCount; ++symbol) {
+            if (visits[symbol] == Visit::None && !setLength(setLength, symbol))
+                return nullptr;
+        }
+
+        return pointer;
+    }
+
+    /**
+     * Read the maps from stored to actual DTZ values, one for each result.
+     */
+    static const uint8_t *setDtzMap(TableFile &tableFile, int files, const uint8_t *pointer, const uint8_t *end) {
+        tableFile.map = pointer;
+
+        for (int file = 0; file < files; ++file) {
+            auto &data = tableFile.tables[0][file];
+            if (!(data.flags & mappedFlag))
+                continue;
+
+            if (data.flags & wideFlag) {
+                pointer = wordAligned(pointer);
+                for (auto &index: data.mapIndex) {
+                    if (end - pointer < 2)
+                        return nullptr;
+                    index = static_cast<uint16_t>((pointer - tableFile.map) / 2 + 1);
+                    if (!skip(pointer, end, readLittleEndian16(pointer) + 1, 2))
+                        return nullptr;
+                }
+            } else {
+                for (auto &index: data.mapIndex) {
+                    if (end - pointer < 1)
+                        return nullptr;
+                    index = static_cast<uint16_t>(pointer - tableFile.map + 1);
+                    if (!skip(pointer, end, *pointer + 1, 1))
+                        return nullptr;
+                }
+            }
+        }
+
+        tableFile.mapSize = pointer - tableFile.map;
+        return wordAligned(pointer);
+    }
+
+    /**
+     * Read the layout of a file, whose sections hold the same part of every
+     * compressed table in turn.
+     */
+    static bool parse(const Table &table, TableFile &tableFile, bool isDtz, const uint8_t *pointer,
+                      const uint8_t *end) {
+        const uint8_t flags = *pointer++;
+        if (static_cast<bool>(flags & hasPawnsFlag) != table.hasPawns ||
+            (!isDtz && static_cast<bool>(flags & splitFlag) != (table.key != table.key2)))
+            return false;
+
+        const int sides = (!isDtz && table.key != table.key2) ? 2 : 1;
+        const int files = table.hasPawns ? 4 : 1;
+        const bool pawnsOnBothSides = table.hasPawns && table.pawnCount[1] > 0;
+
+        for (int file = 0; file < files; ++file) {
+            if (end - pointer < 1 + pawnsOnBothSides + table.pieceCount)
+                return false;
+
+            const int order[2][2]{
+                    {pointer[0] & 0xF, pawnsOnBothSides ? pointer[1] & 0xF : 0xF},
+                    {pointer[0] >> 4,  pawnsOnBothSides ? pointer[1] >> 4 : 0xF},
+            };
+            pointer += 1 + pawnsOnBothSides;
+
+            for (int k = 0; k < table.pieceCount; ++k, ++pointer) {
+                for (int side = 0; side < sides; ++side)
+                    tableFile.tables[side][file].pieces[k] = side ? *pointer >> 4 : *pointer & 0xF;
+            }
+
+            for (int side = 0; side < sides; ++side) {
+                if (!setGroups(table, tableFile.tables[side][file], order[side], file))
+                    return false;
+            }
+        }
+
+        pointer = wordAligned(pointer);
+
+        for (int file = 0; file < files; ++file) {
+            for (int side = 0; side < sides; ++side) {
+                if (!(pointer = setSizes(tableFile.tables[side][file], pointer, end)))
+                    return false;
+            }
+        }
+
+        if (isDtz && !(pointer = setDtzMap(tableFile, files, pointer, end)))
+            return false;
+
+        for (int file = 0; file < files; ++file) {
+            for (int side = 0; side < sides; ++side) {
+                auto &data = tableFile.tables[side][file];
+                data.sparseIndex = pointer;
+                if (!skip(pointer, end, data.sparseIndexSize, 6))
+                    return false;
+            }
+        }
+
+        for (int file = 0; file < files; ++file) {
+            for (int side = 0; side < sides; ++side) {
+                auto &data = tableFile.tables[side][file];
+                data.blockLengths = pointer;
+                if (!skip(pointer, end, data.blockLengthsSize, 2))
+                    return false;
+            }
+        }
+
+        for (int file = 0; file < files; ++file) {
+            for (int side = 0; side < sides; ++side) {
+                // Blocks start on a 64 byte boundary
+                pointer += (64 - reinterpret_cast<uintptr_t>(pointer) % 64) % 64;
+
+                auto &data = tableFile.tables[side][file];
+                data.data = pointer;
+                if (!skip(pointer, end, data.blockCount, data.blockSize))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool mapFile(const Table &table, TableFile &tableFile, bool isDtz) {
+        if (tableFile.path.empty())
+            return false;
+
+        tableFile.file.setFileName(QString::fromStdString(tableFile.path));
+        if (!tableFile.file.open(QIODevice::ReadOnly))
+            return false;
+
+        // Files consist of a 16 byte header followed by 64 byte aligned blocks
+        const auto size = tableFile.file.size();
+        const uchar *data = (size % 64 == 16) ? tableFile.file.map(0, size) : nullptr;
+        if (!data || std::memcmp(data, isDtz ? dtzMagic : wdlMagic, 4) != 0 ||
+            !parse(table, tableFile, isDtz, data + 4, data + size)) {
+            tableFile.file.close();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Map a file the first time it is needed. Threads only wait for each
+     * other while a file is being mapped.
+     */
+    static bool ensureMapped(const Table &table, TableFile &tableFile, bool isDtz) {
+        if (tableFile.isReady.load(std::memory_order_acquire))
+            return tableFile.isValid;
+
+        std::scoped_lock lock(mappingMutex);
+        if (!tableFile.isReady.load(std::memory_order_relaxed)) {
+            tableFile.isValid = mapFile(table, tableFile, isDtz);
+            tableFile.isReady.store(true, std::memory_order_release);
+        }
+        return tableFile.isValid;
+    }
+
+    /**
+     * Decode the value of the position with the given index.
+     */
+    static std::optional<int> decompress(const PairsData &data, uint64_t index) {
+        if (data.flags & singleValueFlag)
+            return data.minSymbolLength;
+
+        // The sparse index gives the block and offset of a nearby position,
+        // from which the blocks are walked to the one holding the position
+        const uint64_t k = index / data.span;
+        if (k >= data.sparseIndexSize)
+            return std::nullopt;
+
+        const auto *entry = data.sparseIndex + 6 * k;
+        uint64_t block = readLittleEndian32(entry);
+        int64_t offset = readLittleEndian16(entry + 4);
+        offset += static_cast<int64_t>(index % data.span) - static_cast<int64_t>(data.span / 2);
+
+        const auto blockLength = [&](uint64_t i) {
+            return static_cast<int64_t>(readLittleEndian16(data.blockLengths + 2 * i));
+        };
+        while (offset < 0) {
+            if (block == 0)
+                return std::nullopt;
+            offset += blockLength(--block) + 1;
+        }
+        while (block < data.blockLengthsSize && offset > blockLength(block))
+            offset -= blockLength(block++) + 1;
+        if (block >= data.blockCount)
+            return std::nullopt;
+
+        // Read Huffman codes until reaching the symbol which covers the offset
+        const auto *pointer = data.data + block * data.blockSize;
+        uint64_t buffer = readBigEndian64(pointer);
+        pointer += 8;
+        int bufferSize = 64;
+
+        int symbol;
+        while (true) {
+            int length = 0;
+            while (buffer < data.base[length])
+                ++length;
+
+            symbol = static_cast<int>((buffer - data.base[length]) >> (64 - length - data.minSymbolLength));
+            symbol += readLittleEndian16(data.lowestSymbols + 2 * length);
+            if (symbol >= static_cast<int>(data.symbolLengths.size()))
+                return std::nullopt;
+
+            if (offset < data.symbolLengths[symbol] + 1)
+                break;
+
+            offset -= data.symbolLengths[symbol] + 1;
+            length += data.minSymbolLength;
+            buffer <<= length;
+            bufferSize -= length;
+
+            if (bufferSize <= 32) {
+                if (data.end - pointer < 4)
+                    return std::nullopt;
+                bufferSize += 32;
+                buffer |= static_cast<uint64_t>(readBigEndian32(pointer)) << (64 - bufferSize);
+                pointer += 4;
+            }
+        }
+
+        // Then expand the symbol into the pair it stands for, down to the value
+        while (data.symbolLengths[symbol]) {
+            const int left = leftSymbol(data.pairs, symbol);
+            if (offset < data.symbolLengths[left] + 1) {
+                symbol = left;
+            } else {
+                offset -= data.symbolLengths[left] + 1;
+                symbol = rightSymbol(data.pairs, symbol);
+            }
+        }
+
+        return leftSymbol(data.pairs, symbol);
+    }
+
+    /**
+     * What a probe found out besides its value.
+     */
+    enum class ProbeState {
+        Fail,
+        Ok,
+
+        /**
+         * The DTZ file only holds the position with the other side to move
+         */
+        ChangeSideToMove,
+
+        /**
+         * The best move is a capture or pawn move, which the stored value may not account for
+         */
+        ZeroingBestMove,
+    };
+
+    static int sign(int value) {
+        return (value > 0) - (value < 0);
+    }
+
+    /**
+     * Turn a stored DTZ value into plies.
+     */
+    static int mapDtz(const TableFile &tableFile, int file, int value, int wdl, ProbeState &state) {
+        // Where the maps for a loss, blessed loss, draw, cursed win and win are
+        static constexpr int mapForResult[5]{1, 3, 0, 2, 0};
+
+        const auto &data = tableFile.tables[0][file];
+        if (data.flags & mappedFlag) {
+            const bool isWide = data.flags & wideFlag;
+            const uint64_t index = data.mapIndex[mapForResult[wdl + 2]] + value;
+            if ((isWide ? 2 * index + 2 : index + 1) > tableFile.mapSize) {
+                state = ProbeState::Fail;
+                return 0;
+            }
+            value = isWide ? readLittleEndian16(tableFile.map + 2 * index) : tableFile.map[index];
+        }
+
+        // Values may be stored in moves rather than plies
+        if ((wdl == 2 && !(data.flags & winPliesFlag)) || (wdl == -2 && !(data.flags & lossPliesFlag)) ||
+            wdl == 1 || wdl == -1)
+            value *= 2;
+
+        return value + 1;
+    }
+
+    /**
+     * The value stored for a position in the WDL or DTZ file of its
+     * endgame. Endgames with more pieces for black, and symmetric ones with
+     * black to move, are looked up with the colors swapped and the board
+     * mirrored. The squares are then mapped to a canonical placement under
+     * the symmetries of the board, and turned into an index.
+     */
+    static int probeTable(const Chess::Board &board, bool isDtz, int wdl, ProbeState &state) {
+        const auto occupied = board.teamOccupiedSquares(Color::White) | board.teamOccupiedSquares(Color::Black);
+        if (occupied.populationCount() == 2)
+            return 0;
+
+        const auto key = materialKey(material(board), Color::White);
+        const auto found = tablesByKey.find(key);
+        if (found == tablesByKey.end()) {
+            state = ProbeState::Fail;
+            return 0;
+        }
+
+        auto &table = *found->second;
+        auto &tableFile = isDtz ? table.dtz : table.wdl;
+        if (!ensureMapped(table, tableFile, isDtz)) {
+            state = ProbeState::Fail;
+            return 0;
+        }
+
+        const auto &ix = indices();
+
+        const bool isBlackToMove = board.turnToMove() == Color::Black;
+        const bool isFlipped = (table.key == table.key2 && isBlackToMove) || key != table.key;
+        const int flipColor = isFlipped ? 8 : 0;
+        const int flipSquares = isFlipped ? 56 : 0;
+        const int sideToMove = isFlipped ^ isBlackToMove;
+
+        int squares[maxPieces];
+        uint8_t pieces[maxPieces];
+        int size = 0;
+        int leadPawnCount = 0;
+        int file = 0;
+
+        const auto pawnOrder = [&ix](int a, int b) {
+            return ix.pawns[a] < ix.pawns[b];
+        };
+
+        // With pawns, the tables are split by the file of the leading pawn
+        std::optional<Color> leadColor;
+        if (table.hasPawns) {
+            leadColor = ((tableFile.tables[0][0].pieces[0] ^ flipColor) & 8) ? Color::Black : Color::White;
+            for (auto pawns = board.pieces(*leadColor, PieceType::Pawn); pawns;)
+                squares[size++] = static_cast<int>(pawns.popLowestSquare()) ^ flipSquares;
+            leadPawnCount = size;
+
+            std::swap(squares[0], *std::max_element(squares, squares + leadPawnCount, pawnOrder));
+            file = std::min(squares[0] % 8, 7 - squares[0] % 8);
+        }
+
+        if (isDtz && (tableFile.tables[0][file].flags & sideToMoveFlag) != sideToMove &&
+            (table.key != table.key2 || table.hasPawns)) {
+            state = ProbeState::ChangeSideToMove;
+            return 0;
+        }
+
+        for (const auto color: {Color::White, Color::Black}) {
+            for (int type = 0; type < 6; ++type) {
+                if (leadColor == color && PieceType(type) == PieceType::Pawn)
+                    continue;
+                for (auto bitboard = board.pieces(color, PieceType(type)); bitboard;) {
+                    squares[size] = static_cast<int>(bitboard.popLowestSquare()) ^ flipSquares;
+                    pieces[size++] = pieceCode(color, PieceType(type)) ^ flipColor;
+                }
+            }
+        }
+
+        const auto &data = tableFile.tables[isDtz ? 0 : sideToMove][file];
+
+        // Put the pieces in the order of the table
+        for (int i = leadPawnCount; i < size - 1; ++i) {
+            for (int j = i + 1; j < size; ++j) {
+                if (data.pieces[i] == pieces[j]) {
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+        }
+
+        // The leading piece goes on the left half of the board
+        if (squares[0] % 8 > 3) {
+            for (int i = 0; i < size; ++i)
+                squares[i] ^= 7;
+        }
+
+        uint64_t index;
+        if (table.hasPawns) {
+            index = ix.leadPawnIndex[leadPawnCount][squares[0]];
+            std::stable_sort(squares + 1, squares + leadPawnCount, pawnOrder);
+            for (int i = 1; i < leadPawnCount; ++i)
+                index += ix.binomial[i][ix.pawns[squares[i]]];
+        } else {
+            // Without pawns, also on the lower half, and the first piece of
+            // the leading group off the diagonal goes below it
+            if (squares[0] / 8 > 3) {
+                for (int i = 0; i < size; ++i)
+                    squares[i] ^= 56;
+            }
+            for (int i = 0; i < data.groupLength[0]; ++i) {
+                if (offDiagonal(squares[i]) == 0)
+                    continue;
+                if (offDiagonal(squares[i]) > 0) {
+                    for (int j = i; j < size; ++j)
+                        squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+                break;
+            }
+
+            if (table.hasUniquePieces) {
+                const int adjust1 = squares[1] > squares[0];
+                const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+                if (offDiagonal(squares[0]))
+                    index = (ix.a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                else if (offDiagonal(squares[1]))
+                    index = (6 * 63 + (squares[0] / 8) * 28 + ix.b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+                else if (offDiagonal(squares[2]))
+                    index = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] / 8) * 7 * 28 +
+                            (squares[1] / 8 - adjust1) * 28 + ix.b1h1h7[squares[2]];
+                else
+                    index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] / 8) * 7 * 6 +
+                            (squares[1] / 8 - adjust1) * 6 + (squares[2] / 8 - adjust2);
+            } else {
+                index = ix.kingPairs[ix.a1d1d4[squares[0]]][squares[1]];
+            }
+        }
+
+        // The other groups are placed on the squares the earlier groups leave
+        index *= data.groupIndex[0];
+        int *groupSquares = squares + data.groupLength[0];
+        bool isRemainingPawns = table.hasPawns && table.pawnCount[1] > 0;
+
+        for (int next = 1; data.groupLength[next]; ++next) {
+            std::stable_sort(groupSquares, groupSquares + data.groupLength[next]);
+
+            uint64_t placement = 0;
+            for (int i = 0; i < data.groupLength[next]; ++i) {
+                const auto adjust = std::count_if(squares, groupSquares, [&](int square) {
+                    return groupSquares[i] > square;
+                });
+                placement += ix.binomial[i + 1][groupSquares[i] - adjust - 8 * isRemainingPawns];
+            }
+
+            isRemainingPawns = false;
+            index += placement * data.groupIndex[next];
+            groupSquares += data.groupLength[next];
+        }
+
+        const auto value = decompress(data, index);
+        if (!value) {
+            state = ProbeState::Fail;
+            return 0;
+        }
+
+        return isDtz ? mapDtz(tableFile, file, *value, wdl, state) : *value - 2;
+    }
+
+    static bool isPawnMove(const Chess::Board &board, const Chess::Move &move) {
+        return board.pieces(board.turnToMove(), PieceType::Pawn).isOccupiedAt(move.from);
+    }
+
+    /**
+     * The WDL value of a position from -2 to 2. The files may store any
+     * value for positions where a capture is best, so captures, and with
+     * checkZeroingMoves pawn moves too, are searched first.
+     */
+    static int search(Chess::Board &board, ProbeState &state, bool checkZeroingMoves) {
+        int bestValue = -2;
+        const auto moves = board.legalMoves();
+        std::size_t moveCount = 0;
+
+        for (const auto &move: moves) {
+            if (!move.dropPiece && (!checkZeroingMoves || !isPawnMove(board, move)))
+                continue;
+
+            ++moveCount;
+
+            board.performMove(move);
+            const int value = -search(board, state, false);
+            board.undoMove();
+
+            if (state == ProbeState::Fail)
+                return 0;
+
+            if (value > bestValue) {
+                bestValue = value;
+                if (value >= 2) {
+                    state = ProbeState::ZeroingBestMove;
+                    return value;
+                }
+            }
+        }
+
+        // If every move was searched, the stored value is not needed, and
+        // it may be wrong, as with an en passant capture
+        const bool isEveryMoveSearched = moveCount != 0 && moveCount == moves.size();
+
+        int value = bestValue;
+        if (!isEveryMoveSearched) {
+            value = probeTable(board, false, 0, state);
+            if (state == ProbeState::Fail)
+                return 0;
+        }
+
+        if (bestValue >= value) {
+            state = (bestValue > 0 || isEveryMoveSearched) ? ProbeState::ZeroingBestMove : ProbeState::Ok;
+            return bestValue;
+        }
+
+        state = ProbeState::Ok;
+        return value;
+    }
+
+    /**
+     * The DTZ of a position whose best move is a capture or pawn move.
+     */
+    static int dtzBeforeZeroing(int wdl) {
+        switch (wdl) {
+            case 2:
+                return 1;
+            case 1:
+                return 101;
+            case -1:
+                return -101;
+            case -2:
+                return -1;
+            default:
+                return 0;
+        }
+    }
+
+    static int probeDtz(Chess::Board &board, ProbeState &state) {
+        state = ProbeState::Ok;
+        const int wdl = search(board, state, true);
+        if (state == ProbeState::Fail || wdl == 0)
+            return 0;
+
+        if (state == ProbeState::ZeroingBestMove)
+            return dtzBeforeZeroing(wdl);
+
+        int dtz = probeTable(board, true, wdl, state);
+        if (state == ProbeState::Fail)
+            return 0;
+
+        if (state != ProbeState::ChangeSideToMove)
+            return (dtz + 100 * (wdl == -1 || wdl == 1)) * sign(wdl);
+
+        // The file holds the other side to move, so look one move ahead for
+        // the best move which keeps the result
+        int bestDtz = 0xFFFF;
+        for (const auto &move: board.legalMoves()) {
+            const bool isZeroing = move.dropPiece || isPawnMove(board, move);
+
+            board.performMove(move);
+
+            dtz = isZeroing ? -dtzBeforeZeroing(search(board, state, false)) : -probeDtz(board, state);
+
+            // A mate is always the best move
+            if (dtz == 1 && board.isInCheck() && board.legalMoves().empty())
+                bestDtz = 1;
+
+            if (!isZeroing)
+                dtz += sign(dtz);
+
+            if (dtz < bestDtz && sign(dtz) == sign(wdl))
+                bestDtz = dtz;
+
+            board.undoMove();
+
+            if (state == ProbeState::Fail)
+                return 0;
+        }
+
+        return bestDtz == 0xFFFF ? -1 : bestDtz;
+    }
+
+    static bool canProbe(const Chess::Board &board) {
+        const auto occupied = board.teamOccupiedSquares(Color::White) | board.teamOccupiedSquares(Color::Black);
+        return occupied.populationCount() <= largestPieceCount && board.castlingMask() == 0;
+    }
+
+    /**
+     * Parse an endgame name such as KRPvKR.
+     */
+    static std::optional<Material> parseName(const std::string &name) {
+        static constexpr std::string_view pieceLetters = "KQRBNP";
+
+        Material material{};
+        int side = 0;
+        for (const char letter: name) {
+            if (letter == 'v' && side == 0) {
+                side = 1;
+                continue;
+            }
+
+            const auto type = pieceLetters.find(letter);
+            if (type == std::string_view::npos)
+                return std::nullopt;
+            ++material[side][type];
+        }
+
+        if (side != 1 || material[0][0] != 1 || material[1][0] != 1)
+            return std::nullopt;
+        return material;
+    }
+
+    static void addTable(const std::string &name, const std::vector<std::filesystem::path> &directories) {
+        const auto material = parseName(name);
+        if (!material)
+            return;
+
+        auto table = std::make_unique<Table>();
+        table->key = materialKey(*material, Color::White);
+        table->key2 = materialKey(*material, Color::Black);
+
+        int pawns[2]{};
+        for (int side = 0; side < 2; ++side) {
+            for (int type = 0; type < 6; ++type) {
+                table->pieceCount += (*material)[side][type];
+                if (PieceType(type) != PieceType::King && (*material)[side][type] == 1)
+                    table->hasUniquePieces = true;
+            }
+            pawns[side] = (*material)[side][static_cast<int>(PieceType::Pawn)];
+        }
+
+        if (table->pieceCount > maxPieces || tablesByKey.count(table->key))
+            return;
+
+        // The leading side is the one with fewer pawns, but some
+        table->hasPawns = pawns[0] + pawns[1] > 0;
+        const bool isWhiteLeading = pawns[1] == 0 || (pawns[0] > 0 && pawns[1] >= pawns[0]);
+        table->pawnCount[0] = isWhiteLeading ? pawns[0] : pawns[1];
+        table->pawnCount[1] = isWhiteLeading ? pawns[1] : pawns[0];
+
+        for (const auto &directory: directories) {
+            std::error_code error;
+            if (table->wdl.path.empty() && std::filesystem::is_regular_file(directory / (name + ".rtbw"), error))
+                table->wdl.path = (directory / (name + ".rtbw")).string();
+            if (table->dtz.path.empty() && std::filesystem::is_regular_file(directory / (name + ".rtbz"), error))
+                table->dtz.path = (directory / (name + ".rtbz")).string();
+        }
+
+        largestPieceCount = std::max(largestPieceCount, table->pieceCount);
+        tablesByKey[table->key] = table.get();
+        tablesByKey[table->key2] = table.get();
+        tables.push_back(std::move(table));
+    }
+
+    int setPath(const std::string &path) {
+        tablesByKey.clear();
+        tables.clear();
+        largestPieceCount = 0;
+
+#ifdef _WIN32
+        static constexpr char separator = ';';
+#else
+        static constexpr char separator = ':';
+#endif
+
+        std::vector<std::filesystem::path> directories;
+        for (std::size_t start = 0; start <= path.size();) {
+            auto stop = path.find(separator, start);
+            if (stop == std::string::npos)
+                stop = path.size();
+            if (stop > start)
+                directories.emplace_back(path.substr(start, stop - start));
+            start = stop + 1;
+        }
+
+        for (const auto &directory: directories) {
+            std::error_code error;
+            for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end;
+                 entry.increment(error)) {
+                if (entry->path().extension() == ".rtbw")
+                    addTable(entry->path().stem().string(), directories);
+            }
+        }
+
+        return static_cast<int>(tables.size());
+    }
+
+    int largest() {
+        return largestPieceCount;
+    }
+
+    std::optional<Wdl> probeWdl(Chess::Board &board) {
+        if (!canProbe(board))
+            return std::nullopt;
+
+        auto state = ProbeState::Ok;
+        const int wdl = search(board, state, false);
+        if (state == ProbeState::Fail)
+            return std::nullopt;
+        return Wdl(wdl);
+    }
+
+    std::optional<int> probeDtz(Chess::Board &board) {
+        if (!canProbe(board))
+            return std::nullopt;
+
+        auto state = ProbeState::Ok;
+        const int dtz = probeDtz(board, state);
+        if (state == ProbeState::Fail)
+            return std::nullopt;
+        return dtz;
+    }
+
+    std::optional<std::vector<int>> probeRootMoves(Chess::Board &board, const std::vector<Chess::Move> &moves) {
+        if (!canProbe(board))
+            return std::nullopt;
+
+        std::vector<int> distances;
+        distances.reserve(moves.size());
+
+        auto state = ProbeState::Ok;
+        for (const auto &move: moves) {
+            board.performMove(move);
+
+            int dtz;
+            if (board.halfMoveClock() == 0) {
+                dtz = dtzBeforeZeroing(-search(board, state, false));
+            } else if (board.halfMoveClock() >= 100) {
+                dtz = 0;
+            } else {
+                // Count the move itself
+                dtz = -probeDtz(board, state);
+                dtz += sign(dtz);
+            }
+
+            if (dtz == 2 && board.isInCheck() && board.legalMoves().empty())
+                dtz = 1;
+
+            board.undoMove();
+
+            if (state == ProbeState::Fail)
+                return std::nullopt;
+            distances.push_back(dtz);
+        }
+
+        return distances;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../chess/board.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Probing of Syzygy endgame tablebases: WDL files (.rtbw) with the result
+ * of every position of an endgame, and DTZ files (.rtbz) with the distance
+ * to the next capture or pawn move which keeps that result. Tables are only
+ * found when the path is set; each file is memory-mapped the first time a
+ * position it covers is probed.
+ *
+ * <p> The tables assume no castling rights, so positions with any are not
+ * probed. The engine only promotes to queens, so a result relying on an
+ * underpromotion in the position itself is not seen.
+ * See https://github.com/syzygy1/tb
+ */
+namespace Ai::Syzygy {
+
+    inline constexpr int maxPieces = 7;
+
+    /**
+     * Result for the side to move. Cursed wins and blessed losses are wins
+     * and losses the fifty move rule turns into draws.
+     */
+    enum class Wdl : int8_t {
+        Loss = -2,
+        BlessedLoss = -1,
+        Draw = 0,
+        CursedWin = 1,
+        Win = 2,
+    };
+
+    /**
+     * Use the tables in a directory, or in several separated by ':' (';' on
+     * Windows), replacing those used before. An empty path disables probing.
+     * Returns the number of endgames found. Must not be called while a
+     * search is running.
+     */
+    int setPath(const std::string &path);
+
+    /**
+     * The number of pieces of the largest endgame found, or 0 if there are none.
+     */
+    [[nodiscard]]
+    int largest();
+
+    /**
+     * The result of a position, or nothing if its endgame is not found.
+     * Safe to call from several threads at once, each with its own board.
+     */
+    [[nodiscard]]
+    std::optional<Wdl> probeWdl(Chess::Board &board);
+
+    /**
+     * The distance in plies to the next capture or pawn move along the best
+     * line, positive if the side to move wins and negative if it loses, with
+     * 100 added to the distance for cursed wins and blessed losses. It is 0
+     * for draws and -1 for checkmate. Nothing if the DTZ file is not found.
+     */
+    [[nodiscard]]
+    std::optional<int> probeDtz(Chess::Board &board);
+
+    /**
+     * The distance to zero of each of the given legal moves, counted from
+     * the position before the move as probeDtz does, or nothing if the
+     * position cannot be probed.
+     */
+    [[nodiscard]]
+    std::optional<std::vector<int>> probeRootMoves(Chess::Board &board, const std::vector<Chess::Move> &moves);
+}
@@ -0,0 +1,81 @@
+#include "timemanager.h"
+#include "../trace/trace.h"
+
+#include <algorithm>
+
+namespace Ai {
+
+    TimeManager::TimeManager(const SearchLimits &limits)
+            : start(std::chrono::steady_clock::now()) {
+        using std::chrono::milliseconds;
+
+        if (limits.infinite)
+            return;
+
+        if (limits.moveTime > milliseconds(0)) {
+            // A fixed move time is used in full, so there is no soft limit
+            this->hasHardLimit = true;
+            this->hardLimit = std::max(limits.moveTime - moveOverhead, milliseconds(1));
+            Trace::instant("Time allocated", "time", {"hard limit ms", this->hardLimit.count()});
+            return;
+        }
+
+        if (limits.time <= milliseconds(0))
+            return;
+
+        // Without moves to go, assume the game lasts this many more moves
+        const int movesToGo = (limits.movesToGo > 0) ? std::min(limits.movesToGo, 50) : 40;
+
+        const auto available = std::max(limits.time - moveOverhead, milliseconds(1));
+        const auto maximum = available * 4 / 5;
+
+        this->hasHardLimit = true;
+        this->hasSoftLimit = true;
+        this->softLimit = std::min(available / movesToGo + limits.increment * 3 / 4, maximum);
+        this->hardLimit = std::clamp(this->softLimit * 4, this->softLimit, maximum);
+        this->adjustedSoftLimit = this->softLimit;
+
+        Trace::instant("Time allocated", "time", {"soft limit ms", this->softLimit.count()},
+                       {"hard limit ms", this->hardLimit.count()});
+    }
+
+    std::chrono::milliseconds TimeManager::elapsed() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start);
+    }
+
+    bool TimeManager::isHardLimitReached() const {
+        return this->hasHardLimit && elapsed() >= this->hardLimit;
+    }
+
+    bool TimeManager::isSoftLimitReached() const {
+        return this->hasSoftLimit && elapsed() >= this->adjustedSoftLimit;
+    }
+
+    void TimeManager::restart() {
+        this->start = std::chrono::steady_clock::now();
+    }
+
+    void TimeManager::update(bool isBestMoveChanged, int score) {
+        this->stableIterations = isBestMoveChanged ? 0 : this->stableIterations + 1;
+
+        // From 1.2 right after the best move changed, down to 0.5 once it has been stable for 7 iterations
+        const double stabilityScale = std::max(0.5, 1.2 - 0.1 * this->stableIterations);
+
+        // Up to double the time when the score drops by two pawns or more
+        double dropScale = 1.0;
+        if (this->hasPreviousScore && score < this->previousScore)
+            dropScale += std::min(this->previousScore - score, 200) / 200.0;
+
+        this->previousScore = score;
+        this->hasPreviousScore = true;
+
+        const auto adjusted = std::chrono::duration_cast<std::chrono::milliseconds>(
+                this->softLimit * stabilityScale * dropScale);
+        this->adjustedSoftLimit = std::min(adjusted, this->hardLimit);
+
+        if (this->hasSoftLimit) {
+            Trace::instant("Soft limit adjusted", "time", {"soft limit ms", this->adjustedSoftLimit.count()},
+                           {"stable iterations", this->stableIterations});
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "searchlimits.h"
+
+#include <chrono>
+
+namespace Ai {
+
+    /**
+     * Decides how long a search may take. The hard limit is never exceeded,
+     * while the soft limit only decides whether to start another iteration,
+     * and is adjusted after each iteration: it is extended when the score
+     * drops, since the position needs more attention, and shortened when the
+     * best move has stayed the same for several iterations.
+     */
+    class TimeManager {
+    public:
+        explicit TimeManager(const SearchLimits &limits);
+
+        [[nodiscard]]
+        std::chrono::milliseconds elapsed() const;
+
+        [[nodiscard]]
+        bool isHardLimitReached() const;
+
+        /**
+         * Whether the next iteration should not be started.
+         */
+        [[nodiscard]]
+        bool isSoftLimitReached() const;
+
+        /**
+         * Count the time from now on, e.g. once a ponder search becomes a normal search.
+         */
+        void restart();
+
+        /**
+         * Adjust the soft limit after a completed iteration.
+         */
+        void update(bool isBestMoveChanged, int score);
+
+    private:
+        /**
+         * Time reserved for everything outside of the search, such as
+         * starting the threads and passing the move on.
+         */
+        static constexpr std::chrono::milliseconds moveOverhead{30};
+
+        std::chrono::time_point<std::chrono::steady_clock> start;
+
+        bool hasHardLimit{false};
+        bool hasSoftLimit{false};
+
+        std::chrono::milliseconds hardLimit{0};
+        std::chrono::milliseconds softLimit{0};
+        std::chrono::milliseconds adjustedSoftLimit{0};
+
+        int stableIterations{0};
+        int previousScore{0};
+        bool hasPreviousScore{false};
+    };
+}
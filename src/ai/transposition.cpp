@@ -0,0 +1,185 @@
+#include "transposition.h"
+#include "../trace/perfcounters.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace Ai {
+
+    static constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+    TranspositionTable::TranspositionTable(std::size_t megabytes) {
+        resize(megabytes);
+    }
+
+    TranspositionTable::~TranspositionTable() {
+        deallocate();
+    }
+
+    void TranspositionTable::resize(std::size_t megabytes, bool useHugePages) {
+        deallocate();
+
+        const std::size_t bytes = std::max<std::size_t>(megabytes, 1) * 1024 * 1024;
+        this->bucketCount = std::bit_floor(bytes / sizeof(Bucket));
+        this->mask = this->bucketCount - 1;
+        this->allocatedBytes = this->bucketCount * sizeof(Bucket);
+
+        std::size_t alignment = alignof(Bucket);
+#if defined(__linux__)
+        if (useHugePages && this->allocatedBytes >= hugePageSize)
+            alignment = hugePageSize;
+#endif
+
+#if defined(_WIN32)
+        void *memory = _aligned_malloc(this->allocatedBytes, alignment);
+#else
+        void *memory = std::aligned_alloc(alignment, this->allocatedBytes);
+#endif
+        if (!memory)
+            throw std::bad_alloc();
+
+#if defined(__linux__)
+        // Only a hint; the kernel falls back to normal pages if none are available
+        if (alignment == hugePageSize)
+            madvise(memory, this->allocatedBytes, MADV_HUGEPAGE);
+#endif
+
+        this->buckets = static_cast<Bucket *>(memory);
+        std::uninitialized_value_construct_n(this->buckets, this->bucketCount);
+
+        this->generation = 0;
+    }
+
+    void TranspositionTable::deallocate() {
+        if (!this->buckets)
+            return;
+
+        std::destroy_n(this->buckets, this->bucketCount);
+#if defined(_WIN32)
+        _aligned_free(this->buckets);
+#else
+        std::free(this->buckets);
+#endif
+        this->buckets = nullptr;
+        this->bucketCount = 0;
+        this->mask = 0;
+        this->allocatedBytes = 0;
+    }
+
+    void TranspositionTable::clear() {
+        for (std::size_t i = 0; i < this->bucketCount; ++i) {
+            for (auto &slot: this->buckets[i].slots) {
+                slot.check.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        this->generation = 0;
+    }
+
+    void TranspositionTable::newSearch() {
+        this->generation = (this->generation + 1) & 63;
+    }
+
+    std::size_t TranspositionTable::size() const {
+        return this->allocatedBytes / (1024 * 1024);
+    }
+
+    // Layout of the data word:
+    //  0-15 move
+    // 16-31 score
+    // 32-39 depth
+    // 40-41 bound
+    // 42-47 generation
+    uint64_t TranspositionTable::pack(int depth, int score, Bound bound, uint16_t move, uint8_t generation) {
+        assert(score >= INT16_MIN && score <= INT16_MAX);
+        depth = std::clamp(depth, INT8_MIN, INT8_MAX);
+
+        return static_cast<uint64_t>(move) |
+               static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16 |
+               static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 32 |
+               static_cast<uint64_t>(bound) << 40 |
+               static_cast<uint64_t>(generation & 63) << 42;
+    }
+
+    bool TranspositionTable::probe(uint64_t key, TranspositionEntry &entry) const {
+        PerfCounters::Scope scope(PerfCounters::Region::HashProbe);
+
+        const auto &bucket = this->buckets[key & this->mask];
+
+        for (const auto &slot: bucket.slots) {
+            const auto data = slot.data.load(std::memory_order_relaxed);
+            const auto check = slot.check.load(std::memory_order_relaxed);
+
+            if (data == 0 || (check ^ data) != key)
+                continue;
+
+            entry.move = static_cast<uint16_t>(data);
+            entry.score = static_cast<int16_t>(data >> 16);
+            entry.depth = static_cast<int8_t>(data >> 32);
+            entry.bound = static_cast<Bound>((data >> 40) & 3);
+            return true;
+        }
+
+        return false;
+    }
+
+    void TranspositionTable::store(uint64_t key, int depth, int score, Bound bound, uint16_t move) {
+        PerfCounters::Scope scope(PerfCounters::Region::HashProbe);
+
+        auto &bucket = this->buckets[key & this->mask];
+
+        Slot *replace = nullptr;
+        int replaceValue = INT_MAX;
+
+        for (auto &slot: bucket.slots) {
+            const auto data = slot.data.load(std::memory_order_relaxed);
+            const auto check = slot.check.load(std::memory_order_relaxed);
+
+            if (data == 0) {
+                if (replaceValue != INT_MIN) {
+                    replace = &slot;
+                    replaceValue = INT_MIN;
+                }
+                continue;
+            }
+
+            const int slotDepth = static_cast<int8_t>(data >> 32);
+            const int slotGeneration = static_cast<int>((data >> 42) & 63);
+
+            if ((check ^ data) == key) {
+                // Same position; keep the previous best move if this search found none,
+                // and keep deeper results from the current search unless this one is exact
+                if (move == 0)
+                    move = static_cast<uint16_t>(data);
+                if (bound != Bound::Exact && slotGeneration == this->generation && depth < slotDepth - 2)
+                    return;
+
+                replace = &slot;
+                break;
+            }
+
+            // Prefer replacing shallow entries and entries left over from earlier searches
+            const int age = (this->generation - slotGeneration) & 63;
+            const int value = slotDepth - 8 * age;
+            if (value < replaceValue) {
+                replace = &slot;
+                replaceValue = value;
+            }
+        }
+
+        const auto data = pack(depth, score, bound, move, this->generation);
+        replace->data.store(data, std::memory_order_relaxed);
+        replace->check.store(key ^ data, std::memory_order_relaxed);
+    }
+}
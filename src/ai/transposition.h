@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "../chess/move.h"
+
+namespace Ai {
+
+    enum class Bound : uint8_t {
+        None,
+        Upper,
+        Lower,
+        Exact,
+    };
+
+    /**
+     * Moves are stored in the table as their origin and target squares only;
+     * the full move is recovered by matching against the generated moves.
+     */
+    constexpr uint16_t encodeMove(const Chess::Move &move) {
+        return static_cast<uint16_t>(static_cast<int>(move.from) | static_cast<int>(move.to) << 6);
+    }
+
+    constexpr bool isSameMove(uint16_t encodedMove, const Chess::Move &move) {
+        return encodedMove != 0 && encodedMove == encodeMove(move);
+    }
+
+    /**
+     * The decoded contents of a transposition table slot.
+     */
+    struct TranspositionEntry {
+        int score;
+        int depth;
+        Bound bound;
+        uint16_t move;
+    };
+
+    /**
+     * Fixed-size hash table of search results, keyed by the Zobrist hash of
+     * the position. It can be shared by several search threads without locks:
+     * every slot stores its data together with the key XORed with that data,
+     * so a slot torn by two concurrent writes fails verification and reads as
+     * a miss.
+     * See https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+     */
+    class TranspositionTable {
+    public:
+        static constexpr std::size_t defaultSize = 64;
+
+        explicit TranspositionTable(std::size_t megabytes = defaultSize);
+
+        ~TranspositionTable();
+
+        TranspositionTable(const TranspositionTable &) = delete;
+
+        TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+        /**
+         * Reallocate the table. The size is rounded down to a power of two
+         * number of buckets. On Linux, the memory is backed by transparent huge
+         * pages when useHugePages is set, which saves TLB misses on probes.
+         * Must not be called while a search is running.
+         */
+        void resize(std::size_t megabytes, bool useHugePages = true);
+
+        void clear();
+
+        /**
+         * Start a new search, so that entries from earlier searches age and are replaced first.
+         */
+        void newSearch();
+
+        [[nodiscard]]
+        bool probe(uint64_t key, TranspositionEntry &entry) const;
+
+        void store(uint64_t key, int depth, int score, Bound bound, uint16_t move);
+
+        /**
+         * Hint the processor to load the bucket of a position into the cache, so
+         * that it is ready by the time the position is probed.
+         */
+        void prefetch(uint64_t key) const {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(&this->buckets[key & this->mask]);
+#endif
+        }
+
+        [[nodiscard]]
+        std::size_t size() const;
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> check;
+            std::atomic<uint64_t> data;
+        };
+
+        static constexpr int slotsPerBucket = 4;
+
+        /**
+         * A bucket fills exactly one cache line, so a probe touches one line only.
+         */
+        struct alignas(64) Bucket {
+            Slot slots[slotsPerBucket];
+        };
+
+        static_assert(sizeof(Bucket) == 64);
+
+        Bucket *buckets{nullptr};
+        std::size_t bucketCount{0};
+        std::size_t mask{0};
+        std::size_t allocatedBytes{0};
+
+        uint8_t generation{0};
+
+        static uint64_t pack(int depth, int score, Bound bound, uint16_t move, uint8_t generation);
+
+        void deallocate();
+    };
+}
@@ -141,6 +141,71 @@ namespace Chess {
             return 63 - std::countl_zero(this->bits);
         }
 
+        /**
+         * Clear the least significant occupied square and return it.
+         */
+        constexpr Square popLowestSquare() {
+            const auto square = Square(bitScanForward());
+            this->bits &= this->bits - 1;
+            return square;
+        }
+
+        [[nodiscard]]
+        constexpr int populationCount() const {
+            return std::popcount(this->bits);
+        }
+
+        /**
+         * Shift every occupied square one step in the given direction. Squares
+         * that would wrap around the edge of the board are discarded.
+         */
+        template<Direction direction>
+        [[nodiscard]]
+        constexpr Bitboard shifted() const {
+            constexpr uint64_t notAFile = ~0x0101010101010101ULL;
+            constexpr uint64_t notHFile = ~0x8080808080808080ULL;
+
+            if constexpr (direction == Direction::NorthWest)
+                return Bitboard((this->bits & notAFile) << 7);
+            else if constexpr (direction == Direction::North)
+                return Bitboard(this->bits << 8);
+            else if constexpr (direction == Direction::NorthEast)
+                return Bitboard((this->bits & notHFile) << 9);
+            else if constexpr (direction == Direction::East)
+                return Bitboard((this->bits & notHFile) << 1);
+            else if constexpr (direction == Direction::SouthEast)
+                return Bitboard((this->bits & notHFile) >> 7);
+            else if constexpr (direction == Direction::South)
+                return Bitboard(this->bits >> 8);
+            else if constexpr (direction == Direction::SouthWest)
+                return Bitboard((this->bits & notAFile) >> 9);
+            else
+                return Bitboard((this->bits & notAFile) >> 1);
+        }
+
+        /**
+         * The occupied squares together with every square north or south of
+         * them, depending on the direction.
+         * See https://www.chessprogramming.org/Pawn_Fills
+         */
+        template<Direction direction>
+        [[nodiscard]]
+        constexpr Bitboard filled() const {
+            static_assert(direction == Direction::North || direction == Direction::South);
+
+            uint64_t bits = this->bits;
+            if constexpr (direction == Direction::North) {
+                bits |= bits << 8;
+                bits |= bits << 16;
+                bits |= bits << 32;
+            } else {
+                bits |= bits >> 8;
+                bits |= bits >> 16;
+                bits |= bits >> 32;
+            }
+            return Bitboard(bits);
+        }
+
         static Square squareToThe(Direction direction, Square square);
 
         friend std::ostream &operator<<(std::ostream &os, const Bitboard &bitboard);
@@ -1,4 +1,7 @@
 #include "board.h"
+#include "zobrist.h"
+#include "psqt.h"
+#include "../trace/perfcounters.h"
 
 #include <sstream>
 #include <regex>
@@ -30,6 +33,60 @@ namespace Chess {
             }
     };
 
+    /*
+     * Per-color constants for the move generator. Every move generation function
+     * is instantiated once per color, so pawn directions, special ranks and
+     * castling squares are all known at compile time.
+     */
+    template<Color color>
+    struct ColorTraits;
+
+    template<>
+    struct ColorTraits<Color::White> {
+        static constexpr int index = 0;
+        static constexpr Color opponent = Color::Black;
+
+        static constexpr Direction forward = Direction::North;
+        static constexpr Direction backward = Direction::South;
+        static constexpr Direction captureWest = Direction::NorthWest;
+        static constexpr Direction captureEast = Direction::NorthEast;
+
+        static constexpr Bitboard startRank = twoRank;
+        static constexpr Bitboard promotionRank = sevenRank;
+
+        static constexpr Castling kingSideCastle = Castling::WhiteKing;
+        static constexpr Square kingSideTransit = Square::F1;
+        static constexpr Square kingSideTarget = Square::G1;
+
+        static constexpr Castling queenSideCastle = Castling::WhiteQueen;
+        static constexpr Square queenSideTransit = Square::D1;
+        static constexpr Square queenSideTarget = Square::C1;
+        static constexpr Square queenSideRookTransit = Square::B1;
+    };
+
+    template<>
+    struct ColorTraits<Color::Black> {
+        static constexpr int index = 1;
+        static constexpr Color opponent = Color::White;
+
+        static constexpr Direction forward = Direction::South;
+        static constexpr Direction backward = Direction::North;
+        static constexpr Direction captureWest = Direction::SouthWest;
+        static constexpr Direction captureEast = Direction::SouthEast;
+
+        static constexpr Bitboard startRank = sevenRank;
+        static constexpr Bitboard promotionRank = twoRank;
+
+        static constexpr Castling kingSideCastle = Castling::BlackKing;
+        static constexpr Square kingSideTransit = Square::F8;
+        static constexpr Square kingSideTarget = Square::G8;
+
+        static constexpr Castling queenSideCastle = Castling::BlackQueen;
+        static constexpr Square queenSideTransit = Square::D8;
+        static constexpr Square queenSideTarget = Square::C8;
+        static constexpr Square queenSideRookTransit = Square::B8;
+    };
+
     const std::array<std::array<Bitboard, 64>, 8> Board::attackRayMasks{
             generateAttackRayMasks(Direction::NorthWest),
             generateAttackRayMasks(Direction::North),
@@ -45,8 +102,6 @@ namespace Chess {
 
     const std::array<Bitboard, 64> Board::kingAttackMasks = generateKingAttackMasks();
 
-    const std::array<std::array<Bitboard, 64>, 2> Board::pawnAttackMasks = generatePawnAttackMasks();
-
     Board::Board() {
         reset();
     }
@@ -63,11 +118,28 @@ namespace Chess {
             castlingRights[0][i] = 0;
             castlingRights[1][i] = 0;
         }
+        this->enPassant = Square::None;
+        this->halfMoveCounter = 0;
+        this->counterReset = 0;
+        this->previousResetValue = 0;
+        // Castling rights record the move number they were revoked on, so counting must start at 1
+        this->fullMoveCounter = 1;
+        this->movesMade.clear();
+        this->history.clear();
         this->playerTurn = Color::White;
+        this->isAttackInfoValid = false;
+        this->key = computeKey();
+        this->pawnKey = computePawnKey();
+        this->pieceSquareScores = computePieceSquareScores();
+        this->phase = computePhase();
     }
 
     void Board::clear() {
         this->bitboards = {};
+        this->pawnKey = 0;
+        this->pieceSquareScores = 0;
+        this->phase = 0;
+        this->isAttackInfoValid = false;
     }
 
     State Board::state() {
@@ -97,14 +169,38 @@ namespace Chess {
     }
 
     void Board::performMove(Move move) {
+        PerfCounters::Scope scope(PerfCounters::Region::MakeUnmake);
+
         assert(isMovePseudoLegal(move));
 
+        this->isAttackInfoValid = false;
+
+        saveHistory();
+
+        const auto &pieceKeys = Zobrist::keys.pieces;
+        const auto &pieceSquares = Psqt::pieceSquareTable;
+        const int previousCastlingMask = castlingMask();
+
         int playerIndex = static_cast<int>(this->playerTurn);
 
+        // Scores are kept from white's point of view
+        const int sign = (this->playerTurn == Color::White) ? 1 : -1;
+
         auto &team = this->bitboards[playerIndex];
 
+        auto &dirty = this->history.back().dirtyPieces;
+
         auto piece = removePieceAt(move.from, this->playerTurn);
         team[static_cast<int>(piece)].setOccupancyAt(move.to);
+        dirty.add(this->playerTurn, piece, move.from, move.to);
+        key ^= pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.from)] ^
+               pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)];
+        pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)] -
+                                     pieceSquares[playerIndex][static_cast<int>(piece)][static_cast<int>(move.from)]);
+        if (piece == PieceType::Pawn) {
+            pawnKey ^= pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.from)] ^
+                       pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)];
+        }
 
         if (piece == PieceType::King) {
             kings[playerIndex] = move.to;
@@ -143,24 +239,44 @@ namespace Chess {
                         Square::H1);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::F1);
+                key ^= pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::H1)] ^
+                       pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::F1)];
+                pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::F1)] -
+                                             pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::H1)]);
+                dirty.add(this->playerTurn, PieceType::Rook, Square::H1, Square::F1);
                 break;
             case Castling::WhiteQueen:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::A1);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::D1);
+                key ^= pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::A1)] ^
+                       pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::D1)];
+                pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::D1)] -
+                                             pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::A1)]);
+                dirty.add(this->playerTurn, PieceType::Rook, Square::A1, Square::D1);
                 break;
             case Castling::BlackKing:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::H8);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::F8);
+                key ^= pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::H8)] ^
+                       pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::F8)];
+                pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::F8)] -
+                                             pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::H8)]);
+                dirty.add(this->playerTurn, PieceType::Rook, Square::H8, Square::F8);
                 break;
             case Castling::BlackQueen:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::A8);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::D8);
+                key ^= pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::A8)] ^
+                       pieceKeys[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::D8)];
+                pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::D8)] -
+                                             pieceSquares[playerIndex][static_cast<int>(PieceType::Rook)][static_cast<int>(Square::A8)]);
+                dirty.add(this->playerTurn, PieceType::Rook, Square::A8, Square::D8);
                 break;
             case Castling::None:
                 break;
@@ -169,6 +285,14 @@ namespace Chess {
         if (move.promotion) {
             removePieceAt(move.to, this->playerTurn);
             team[static_cast<int>(PieceType::Queen)].setOccupancyAt(move.to);
+            key ^= pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)] ^
+                   pieceKeys[playerIndex][static_cast<int>(PieceType::Queen)][static_cast<int>(move.to)];
+            pieceSquareScores += sign * (pieceSquares[playerIndex][static_cast<int>(PieceType::Queen)][static_cast<int>(move.to)] -
+                                         pieceSquares[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)]);
+            phase += Psqt::phaseWeights[static_cast<int>(PieceType::Queen)];
+            dirty.pieces[0].to = Square::None;
+            dirty.add(this->playerTurn, PieceType::Queen, Square::None, move.to);
+            pawnKey ^= pieceKeys[playerIndex][static_cast<int>(piece)][static_cast<int>(move.to)];
         }
 
         if (move.dropPiece) {
@@ -181,6 +305,16 @@ namespace Chess {
             auto &enemyTeam
                     = this->bitboards[static_cast<int>(oppositeTeam(this->playerTurn))];
             enemyTeam[static_cast<int>(*move.dropPiece)].clearOccupancyAt(dropSquare);
+            key ^= pieceKeys[static_cast<int>(oppositeTeam(this->playerTurn))]
+                            [static_cast<int>(*move.dropPiece)][static_cast<int>(dropSquare)];
+            pieceSquareScores += sign * pieceSquares[static_cast<int>(oppositeTeam(this->playerTurn))]
+                                                    [static_cast<int>(*move.dropPiece)][static_cast<int>(dropSquare)];
+            phase -= Psqt::phaseWeights[static_cast<int>(*move.dropPiece)];
+            dirty.add(oppositeTeam(this->playerTurn), *move.dropPiece, dropSquare, Square::None);
+            if (move.dropPiece == PieceType::Pawn) {
+                pawnKey ^= pieceKeys[static_cast<int>(oppositeTeam(this->playerTurn))]
+                                    [static_cast<int>(PieceType::Pawn)][static_cast<int>(dropSquare)];
+            }
 
             if (move.dropPiece == PieceType::Rook) {
                 if (dropSquare == Square::A1)
@@ -194,7 +328,14 @@ namespace Chess {
             }
         }
 
+        if (enPassant != Square::None)
+            key ^= Zobrist::keys.enPassant[static_cast<int>(enPassant) % 8];
         enPassant = move.enPassant;
+        if (enPassant != Square::None)
+            key ^= Zobrist::keys.enPassant[static_cast<int>(enPassant) % 8];
+
+        key ^= Zobrist::keys.castling[previousCastlingMask] ^ Zobrist::keys.castling[castlingMask()];
+        key ^= Zobrist::keys.blackToMove;
 
         ++this->halfMoveCounter;
 
@@ -206,16 +347,81 @@ namespace Chess {
         if (this->playerTurn == Color::Black)
             ++this->fullMoveCounter;
 
-        this->enPassant = Square::None;
-
         this->playerTurn = oppositeTeam(playerTurn);
 
         this->movesMade.push_back(move);
+
+        assert(key == computeKey());
+        assert(pawnKey == computePawnKey());
+        assert(pieceSquareScores == computePieceSquareScores());
+        assert(phase == computePhase());
+    }
+
+    void Board::saveHistory() {
+        auto &state = this->history.emplace_back();
+        for (int i = 0; i < 3; ++i) {
+            state.castlingRights[0][i] = castlingRights[0][i];
+            state.castlingRights[1][i] = castlingRights[1][i];
+        }
+        state.enPassant = this->enPassant;
+        state.counterReset = this->counterReset;
+        state.previousResetValue = this->previousResetValue;
+        state.key = this->key;
+        state.pawnKey = this->pawnKey;
+        state.pieceSquareScores = this->pieceSquareScores;
+        state.phase = this->phase;
+    }
+
+    void Board::performNullMove() {
+        PerfCounters::Scope scope(PerfCounters::Region::MakeUnmake);
+
+        assert(!isInCheck());
+
+        this->isAttackInfoValid = false;
+
+        saveHistory();
+
+        if (enPassant != Square::None)
+            key ^= Zobrist::keys.enPassant[static_cast<int>(enPassant) % 8];
+        enPassant = Square::None;
+
+        key ^= Zobrist::keys.blackToMove;
+
+        ++this->halfMoveCounter;
+
+        if (this->playerTurn == Color::Black)
+            ++this->fullMoveCounter;
+
+        this->playerTurn = oppositeTeam(playerTurn);
+
+        assert(key == computeKey());
+    }
+
+    void Board::undoNullMove() {
+        PerfCounters::Scope scope(PerfCounters::Region::MakeUnmake);
+
+        const auto state = this->history.back();
+        this->history.pop_back();
+        this->isAttackInfoValid = false;
+        this->playerTurn = oppositeTeam(playerTurn);
+
+        if (this->playerTurn == Color::Black)
+            --this->fullMoveCounter;
+
+        --this->halfMoveCounter;
+
+        this->enPassant = state.enPassant;
+        this->key = state.key;
     }
 
     void Board::undoMove() {
+        PerfCounters::Scope scope(PerfCounters::Region::MakeUnmake);
+
         auto move = this->movesMade.back();
         movesMade.pop_back();
+        const auto state = this->history.back();
+        this->history.pop_back();
+        this->isAttackInfoValid = false;
         this->playerTurn = oppositeTeam(playerTurn);
         int playerIndex = static_cast<int>(playerTurn);
 
@@ -230,15 +436,6 @@ namespace Chess {
         if (piece == PieceType::King)
             kings[playerIndex] = move.from;
 
-        if (piece == PieceType::King) {
-            kings[playerIndex] = move.from;
-            if (move.from == Square::E1 && castlingRights[0][0] == fullMoveCounter)
-                castlingRights[0][0] = 0;
-            if (move.from == Square::E8 && castlingRights[1][0] == fullMoveCounter - 1)
-                castlingRights[1][0] = 0;
-
-        }
-
         // Castling
         switch (move.castle) {
             case Castling::WhiteKing:
@@ -246,50 +443,29 @@ namespace Chess {
                         Square::F1);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::H1);
-                castlingRights[0][0] = 0;
-                castlingRights[0][2] = 0;
                 break;
             case Castling::WhiteQueen:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::D1);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::A1);
-                castlingRights[0][0] = 0;
-                castlingRights[0][1] = 0;
                 break;
             case Castling::BlackKing:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::F8);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::H8);
-                castlingRights[1][0] = 0;
-                castlingRights[1][2] = 0;
                 break;
             case Castling::BlackQueen:
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].clearOccupancyAt(
                         Square::D8);
                 this->bitboards[playerIndex][static_cast<int>(PieceType::Rook)].setOccupancyAt(
                         Square::A8);
-                castlingRights[1][0] = 0;
-                castlingRights[1][1] = 0;
                 break;
             case Castling::None:
                 break;
         }
 
-
-        if (piece == PieceType::Rook) {
-            if (move.from == Square::A1 && castlingRights[0][1] == fullMoveCounter)
-                castlingRights[0][1] = 0;
-            if (move.from == Square::A8 && castlingRights[1][1] == fullMoveCounter)
-                castlingRights[1][1] = 0;
-            if (move.from == Square::H1 && castlingRights[0][2] == fullMoveCounter)
-                castlingRights[0][2] = 0;
-            if (move.from == Square::H8 && castlingRights[1][2] == fullMoveCounter)
-                castlingRights[1][2] = 0;
-        }
-
-
         if (move.dropPiece) {
             Square dropSquare = move.to;
 
@@ -301,38 +477,142 @@ namespace Chess {
             auto &enemyTeam
                     = this->bitboards[static_cast<int>(oppositeTeam(this->playerTurn))];
             enemyTeam[static_cast<int>(*move.dropPiece)].setOccupancyAt(dropSquare);
-
-            if (move.dropPiece == PieceType::Rook) {
-                if (dropSquare == Square::A1 && castlingRights[0][1] == fullMoveCounter)
-                    castlingRights[0][1] = 0;
-                else if (dropSquare == Square::A8 && castlingRights[1][1] == fullMoveCounter)
-                    castlingRights[1][1] = 0;
-                else if (dropSquare == Square::H1 && castlingRights[0][2] == fullMoveCounter)
-                    castlingRights[0][2] = 0;
-                else if (dropSquare == Square::H8 && castlingRights[1][2] == fullMoveCounter)
-                    castlingRights[1][2] = 0;
-            }
         }
 
         if (this->playerTurn == Color::Black)
             --this->fullMoveCounter;
 
-        if (movesMade.empty())
-            this->enPassant = Square::None;
-        else
-            this->enPassant = movesMade.back().enPassant;
-
         --this->halfMoveCounter;
 
-        if (move.dropPiece || piece == PieceType::Pawn) {
-            counterReset = previousResetValue;
+        for (int i = 0; i < 3; ++i) {
+            castlingRights[0][i] = state.castlingRights[0][i];
+            castlingRights[1][i] = state.castlingRights[1][i];
         }
+        this->enPassant = state.enPassant;
+        this->counterReset = state.counterReset;
+        this->previousResetValue = state.previousResetValue;
+        this->key = state.key;
+        this->pawnKey = state.pawnKey;
+        this->pieceSquareScores = state.pieceSquareScores;
+        this->phase = state.phase;
     }
 
     Color Board::turnToMove() const {
         return this->playerTurn;
     }
 
+    uint64_t Board::hash() const {
+        return this->key;
+    }
+
+    uint64_t Board::pawnHash() const {
+        return this->pawnKey;
+    }
+
+    std::size_t Board::historySize() const {
+        return this->history.size();
+    }
+
+    uint64_t Board::hashBefore(std::size_t index) const {
+        assert(index < this->history.size());
+        return this->history[index].key;
+    }
+
+    const DirtyPieces &Board::dirtyPieces(std::size_t index) const {
+        assert(index < this->history.size());
+        return this->history[index].dirtyPieces;
+    }
+
+    Square Board::kingSquare(Color color) const {
+        return this->kings[static_cast<int>(color)];
+    }
+
+    Square Board::enPassantSquare() const {
+        return this->enPassant;
+    }
+
+    int Board::halfMoveClock() const {
+        return this->halfMoveCounter - this->counterReset;
+    }
+
+    int Board::pieceSquareScore() const {
+        return Psqt::taperedValue(this->pieceSquareScores, this->phase);
+    }
+
+    int Board::gamePhase() const {
+        return this->phase;
+    }
+
+    int Board::castlingMask() const {
+        int mask = 0;
+        if (!castlingRights[0][0] && !castlingRights[0][2])
+            mask |= 1;
+        if (!castlingRights[0][0] && !castlingRights[0][1])
+            mask |= 2;
+        if (!castlingRights[1][0] && !castlingRights[1][2])
+            mask |= 4;
+        if (!castlingRights[1][0] && !castlingRights[1][1])
+            mask |= 8;
+        return mask;
+    }
+
+    uint64_t Board::computeKey() const {
+        uint64_t result = 0;
+
+        for (int i = 0; i < 2; ++i) {
+            for (int j = 0; j < 6; ++j) {
+                for (auto pieces = this->bitboards[i][j]; pieces;)
+                    result ^= Zobrist::keys.pieces[i][j][static_cast<int>(pieces.popLowestSquare())];
+            }
+        }
+
+        result ^= Zobrist::keys.castling[castlingMask()];
+
+        if (this->enPassant != Square::None)
+            result ^= Zobrist::keys.enPassant[static_cast<int>(this->enPassant) % 8];
+
+        if (this->playerTurn == Color::Black)
+            result ^= Zobrist::keys.blackToMove;
+
+        return result;
+    }
+
+    uint64_t Board::computePawnKey() const {
+        uint64_t result = 0;
+
+        for (int i = 0; i < 2; ++i) {
+            for (auto pawns = this->bitboards[i][static_cast<int>(PieceType::Pawn)]; pawns;)
+                result ^= Zobrist::keys.pieces[i][static_cast<int>(PieceType::Pawn)][static_cast<int>(pawns.popLowestSquare())];
+        }
+
+        return result;
+    }
+
+    int Board::computePieceSquareScores() const {
+        int result = 0;
+
+        for (int i = 0; i < 2; ++i) {
+            const int sign = (i == static_cast<int>(Color::White)) ? 1 : -1;
+            for (int j = 0; j < 6; ++j) {
+                for (auto pieces = this->bitboards[i][j]; pieces;)
+                    result += sign * Psqt::pieceSquareTable[i][j][static_cast<int>(pieces.popLowestSquare())];
+            }
+        }
+
+        return result;
+    }
+
+    int Board::computePhase() const {
+        int result = 0;
+
+        for (const auto &team: this->bitboards) {
+            for (int j = 0; j < 6; ++j)
+                result += Psqt::phaseWeights[j] * team[j].populationCount();
+        }
+
+        return result;
+    }
+
     void Board::parseFen(const std::string &fen) {
         auto charToPiece = [](char c) -> PieceType {
             switch (toupper(c)) {
@@ -352,6 +632,8 @@ namespace Chess {
         };
 
         clear();
+        this->movesMade.clear();
+        this->history.clear();
 
         auto itr = fen.begin();
 
@@ -439,6 +721,11 @@ namespace Chess {
             fullMoveCounter = fullMoveCounter * 10 + *itr - '0';
             itr++;
         }
+
+        key = computeKey();
+        pawnKey = computePawnKey();
+        pieceSquareScores = computePieceSquareScores();
+        phase = computePhase();
     }
 
     std::string Board::generateFen() const {
@@ -563,46 +850,232 @@ namespace Chess {
         return !squareThreatened(kings[static_cast<int>(oppositeTeam(playerTurn))], playerTurn);
     }
 
+    bool Board::isLegal(Move move, const AttackInfo &info) {
+        PerfCounters::Scope scope(PerfCounters::Region::MoveGeneration);
+
+        const auto us = static_cast<int>(this->playerTurn);
+        const auto them = static_cast<int>(oppositeTeam(this->playerTurn));
+
+        if (!info.checkers && !move.enPassantCapture) {
+            // Castling moves have already been checked for attacked squares by the move generator
+            if (move.from == this->kings[us])
+                return move.castle != Castling::None || !info.attacked[them].isOccupiedAt(move.to);
+
+            if (!info.pinned.isOccupiedAt(move.from))
+                return true;
+        } else if (info.checkers && !move.enPassantCapture && move.from != this->kings[us]) {
+            // Only a single check can be answered by another piece than the
+            // king, by capturing the checker or stepping between it and the
+            // king, and a pinned piece can do neither without exposing the king
+            if (info.checkers.populationCount() > 1 || info.pinned.isOccupiedAt(move.from))
+                return false;
+
+            const auto checker = Square(info.checkers.bitScanForward());
+            if (move.to == checker)
+                return true;
+
+            const auto &enemy = this->bitboards[them];
+            if ((enemy[static_cast<int>(PieceType::Knight)] | enemy[static_cast<int>(PieceType::Pawn)])
+                    .isOccupiedAt(checker))
+                return false;
+
+            // The squares between two squares on a line are the ones attacked from both along it
+            const auto king = this->kings[us];
+            const Bitboard occupiedSquares = teamOccupiedSquares(Color::White) | teamOccupiedSquares(Color::Black);
+            const bool isStraight = static_cast<int>(king) % 8 == static_cast<int>(checker) % 8 ||
+                                    static_cast<int>(king) / 8 == static_cast<int>(checker) / 8;
+            const Bitboard between = isStraight
+                                     ? rookAttacks(king, occupiedSquares) & rookAttacks(checker, occupiedSquares)
+                                     : bishopAttacks(king, occupiedSquares) & bishopAttacks(checker, occupiedSquares);
+            return between.isOccupiedAt(move.to);
+        }
+
+        performMove(move);
+        const bool legal = isLegal();
+        undoMove();
+
+        return legal;
+    }
+
+    bool Board::isInCheck() const {
+        if (this->isAttackInfoValid)
+            return static_cast<bool>(this->attackInfoCache.checkers);
+
+        return squareThreatened(this->kings[static_cast<int>(this->playerTurn)], oppositeTeam(this->playerTurn));
+    }
+
     bool Board::squareThreatened(Chess::Square square, Chess::Color opponentColor) const {
-        return squaresThreatened(opponentColor).isOccupiedAt(square);
+        switch (opponentColor) {
+            case Color::White:
+                return squareThreatened<Color::White>(square);
+            case Color::Black:
+                return squareThreatened<Color::Black>(square);
+        }
+
+        assert(false);
+        return false;
+    }
+
+    template<Color color>
+    bool Board::squareThreatened(Square square) const {
+        const auto &team = this->bitboards[ColorTraits<color>::index];
+        const Bitboard occupiedSquares = teamOccupiedSquares(Color::White) | teamOccupiedSquares(Color::Black);
+
+        const Bitboard queens = team[static_cast<int>(PieceType::Queen)];
+
+        // A pawn of the opposite color on the square would threaten exactly
+        // the squares our pawns would have to stand on to threaten it
+        return knightAttacks(square).isOverlappingWith(team[static_cast<int>(PieceType::Knight)]) ||
+               kingAttacks(square).isOverlappingWith(team[static_cast<int>(PieceType::King)]) ||
+               pawnThreatens<ColorTraits<color>::opponent>(square).isOverlappingWith(
+                       team[static_cast<int>(PieceType::Pawn)]) ||
+               rookAttacks(square, occupiedSquares).isOverlappingWith(
+                       team[static_cast<int>(PieceType::Rook)] | queens) ||
+               bishopAttacks(square, occupiedSquares).isOverlappingWith(
+                       team[static_cast<int>(PieceType::Bishop)] | queens);
     }
 
     Bitboard Board::squaresThreatened(Chess::Color opponentColor) const {
-        Bitboard occupiedSquares = teamOccupiedSquares(Color::White) | teamOccupiedSquares(Color::Black);
-        Bitboard targetedSquares;
-
-        auto addAttackMasks = [&](Bitboard bitboard, PieceType piece) -> void {
-            for (int i = 0; i < 64; ++i) {
-                if (bitboard.isOccupiedAt(Square(i))) {
-                    Bitboard attacks;
-                    switch (piece) {
-                        case PieceType::King:
-                            attacks = kingAttacks(Square(i));
-                            break;
-                        case PieceType::Queen:
-                            attacks = queenAttacks(Square(i), occupiedSquares);
-                            break;
-                        case PieceType::Rook:
-                            attacks = rookAttacks(Square(i), occupiedSquares);
-                            break;
-                        case PieceType::Bishop:
-                            attacks = bishopAttacks(Square(i), occupiedSquares);
-                            break;
-                        case PieceType::Knight:
-                            attacks = knightAttacks(Square(i));
-                            break;
-                        case PieceType::Pawn:
-                            attacks = pawnThreatens(Square(i), opponentColor);
-                            break;
-                    }
-                    targetedSquares |= attacks;
-                }
+        return attackInfo().attacked[static_cast<int>(opponentColor)];
+    }
+
+    const AttackInfo &Board::attackInfo() const {
+        if (!this->isAttackInfoValid) {
+            switch (this->playerTurn) {
+                case Color::White:
+                    computeAttackInfo<Color::White>(this->attackInfoCache);
+                    break;
+                case Color::Black:
+                    computeAttackInfo<Color::Black>(this->attackInfoCache);
+                    break;
             }
-        };
+            this->isAttackInfoValid = true;
+        }
+
+        return this->attackInfoCache;
+    }
+
+    template<Color color>
+    void Board::computeAttackInfo(AttackInfo &info) const {
+        using Traits = ColorTraits<color>;
+
+        const Bitboard occupiedSquares = teamOccupiedSquares(Color::White) | teamOccupiedSquares(Color::Black);
+
+        computeTeamAttacks<Color::White>(info.attacks[0], occupiedSquares);
+        computeTeamAttacks<Color::Black>(info.attacks[1], occupiedSquares);
+
+        for (int i = 0; i < 2; ++i) {
+            info.attacked[i] = {};
+            for (auto attacks: info.attacks[i])
+                info.attacked[i] |= attacks;
+
+            info.kingZones[i] = (this->kings[i] != Square::None)
+                                ? kingAttacks(this->kings[i]) | Bitboard(this->kings[i])
+                                : Bitboard();
+        }
+
+        const auto king = this->kings[Traits::index];
+        assert(king != Square::None);
+
+        const auto &enemy = this->bitboards[ColorTraits<Traits::opponent>::index];
+        const Bitboard queens = enemy[static_cast<int>(PieceType::Queen)];
+
+        info.checkers = (knightAttacks(king) & enemy[static_cast<int>(PieceType::Knight)]) |
+                        (pawnThreatens<color>(king) & enemy[static_cast<int>(PieceType::Pawn)]) |
+                        (rookAttacks(king, occupiedSquares) &
+                         (enemy[static_cast<int>(PieceType::Rook)] | queens)) |
+                        (bishopAttacks(king, occupiedSquares) &
+                         (enemy[static_cast<int>(PieceType::Bishop)] | queens));
+
+        info.pinned = pinnedPieces<color>();
+    }
+
+    template<Color color>
+    void Board::computeTeamAttacks(std::array<Bitboard, 6> &attacks, Bitboard occupiedSquares) const {
+        const auto &team = this->bitboards[ColorTraits<color>::index];
+
+        attacks = {};
+
+        for (auto pieces = team[static_cast<int>(PieceType::King)]; pieces;)
+            attacks[static_cast<int>(PieceType::King)] |= kingAttacks(pieces.popLowestSquare());
+
+        for (auto pieces = team[static_cast<int>(PieceType::Queen)]; pieces;)
+            attacks[static_cast<int>(PieceType::Queen)] |= queenAttacks(pieces.popLowestSquare(), occupiedSquares);
+
+        for (auto pieces = team[static_cast<int>(PieceType::Rook)]; pieces;)
+            attacks[static_cast<int>(PieceType::Rook)] |= rookAttacks(pieces.popLowestSquare(), occupiedSquares);
+
+        for (auto pieces = team[static_cast<int>(PieceType::Bishop)]; pieces;)
+            attacks[static_cast<int>(PieceType::Bishop)] |= bishopAttacks(pieces.popLowestSquare(), occupiedSquares);
+
+        for (auto pieces = team[static_cast<int>(PieceType::Knight)]; pieces;)
+            attacks[static_cast<int>(PieceType::Knight)] |= knightAttacks(pieces.popLowestSquare());
+
+        // Pawn threats can be computed for all pawns at once
+        const Bitboard pawns = team[static_cast<int>(PieceType::Pawn)];
+        attacks[static_cast<int>(PieceType::Pawn)] = pawns.shifted<ColorTraits<color>::captureWest>() |
+                                                     pawns.shifted<ColorTraits<color>::captureEast>();
+    }
+
+    template<Color color>
+    Bitboard Board::pinnedPieces() const {
+        const auto king = this->kings[ColorTraits<color>::index];
+        const auto ourSquares = teamOccupiedSquares(color);
+        const auto occupiedSquares = ourSquares | teamOccupiedSquares(ColorTraits<color>::opponent);
+
+        const auto &enemy = this->bitboards[ColorTraits<ColorTraits<color>::opponent>::index];
+        const Bitboard queens = enemy[static_cast<int>(PieceType::Queen)];
+        const Bitboard straightSliders = enemy[static_cast<int>(PieceType::Rook)] | queens;
+        const Bitboard diagonalSliders = enemy[static_cast<int>(PieceType::Bishop)] | queens;
+
+        Bitboard pinned;
+
+        // A piece is pinned if it is the first piece on a ray from the king,
+        // and the second piece on that ray is an enemy slider moving along it
+        for (int i = 0; i < 8; ++i) {
+            const auto direction = Direction(i);
+
+            bool isDiagonal{false};
+            bool isPositive{false};
+            switch (direction) {
+                case Direction::NorthWest:
+                case Direction::NorthEast:
+                    isDiagonal = true;
+                    isPositive = true;
+                    break;
+                case Direction::North:
+                case Direction::East:
+                    isPositive = true;
+                    break;
+                case Direction::SouthEast:
+                case Direction::SouthWest:
+                    isDiagonal = true;
+                    break;
+                case Direction::South:
+                case Direction::West:
+                    break;
+            }
+
+            const auto ray = attackRayMasks[i][static_cast<int>(king)];
+            const auto sliders = isDiagonal ? diagonalSliders : straightSliders;
+            if (!ray.isOverlappingWith(sliders))
+                continue;
+
+            auto blockers = ray & occupiedSquares;
+            if (blockers.populationCount() < 2)
+                continue;
 
-        for (int i = 0; i < 6; ++i)
-            addAttackMasks(bitboards[static_cast<int>(opponentColor)][i], PieceType(i));
-        return targetedSquares;
+            const auto first = Square(isPositive ? blockers.bitScanForward() : blockers.bitScanReverse());
+            if (!ourSquares.isOccupiedAt(first))
+                continue;
+
+            blockers.clearOccupancyAt(first);
+            const auto second = Square(isPositive ? blockers.bitScanForward() : blockers.bitScanReverse());
+            if (sliders.isOccupiedAt(second))
+                pinned.setOccupancyAt(first);
+        }
+
+        return pinned;
     }
 
     bool Board::canCastleThrough(Square square, Bitboard occupiedSquares) const {
@@ -613,13 +1086,11 @@ namespace Chess {
         std::vector<Move> movesToFilter = pseudoLegalMoves();
         std::vector<Move> resultVector;
 
+        const auto info = attackInfo();
 
         for (auto move: movesToFilter) {
-            this->performMove(move);
-            if (this->isLegal()) {
+            if (isLegal(move, info))
                 resultVector.emplace_back(move);
-            }
-            this->undoMove();
         }
         if (resultVector.empty()) {
             // TODO: End condition.
@@ -632,13 +1103,11 @@ namespace Chess {
         std::vector<Move> movesToFilter = pseudoLegalMoves(square);
         std::vector<Move> resultVector;
 
+        const auto info = attackInfo();
 
         for (auto move: movesToFilter) {
-            this->performMove(move);
-            if (this->isLegal()) {
+            if (isLegal(move, info))
                 resultVector.emplace_back(move);
-            }
-            this->undoMove();
         }
         if (resultVector.empty()) {
             // TODO: End condition.
@@ -649,11 +1118,21 @@ namespace Chess {
 
     std::vector<Move> Board::pseudoLegalMoves() const {
         std::vector<Move> moves;
+        pseudoLegalMoves(moves);
+        return moves;
+    }
 
-        for (int pieceIndex = 0; pieceIndex < 6; ++pieceIndex)
-            pseudoLegalMoves(PieceType(pieceIndex), moves);
+    void Board::pseudoLegalMoves(std::vector<Move> &moves) const {
+        PerfCounters::Scope scope(PerfCounters::Region::MoveGeneration);
 
-        return moves;
+        switch (this->playerTurn) {
+            case Color::White:
+                generateMoves<Color::White>(moves);
+                break;
+            case Color::Black:
+                generateMoves<Color::Black>(moves);
+                break;
+        }
     }
 
     std::vector<Move> Board::pseudoLegalMoves(PieceType piece) const {
@@ -663,14 +1142,13 @@ namespace Chess {
     }
 
     void Board::pseudoLegalMoves(PieceType piece, std::vector<Move> &moves) const {
-        Bitboard bitboard = this->bitboards[static_cast<int>(this->playerTurn)][static_cast<int>(piece)];
-
-        for (int i = 0; i < 64; ++i) {
-            auto from = Square(i);
-            if (!bitboard.isOccupiedAt(from))
-                continue;
-
-            pseudoLegalMoves(from, moves);
+        switch (this->playerTurn) {
+            case Color::White:
+                generateMoves<Color::White>(piece, moves);
+                break;
+            case Color::Black:
+                generateMoves<Color::Black>(piece, moves);
+                break;
         }
     }
 
@@ -691,129 +1169,247 @@ namespace Chess {
     }
 
     void Board::pseudoLegalMoves(Square square, Color color, std::vector<Move> &moves) const {
-        const auto ourSquares = teamOccupiedSquares(color);
-        const auto enemySquares = teamOccupiedSquares(oppositeTeam(color));
-        const auto occupiedSquares = ourSquares | enemySquares;
-
-        // If the selected square isn't from the current player, there are no valid moves
-        if (!ourSquares.isOccupiedAt(square))
+        // If the selected square isn't from the given player, there are no valid moves
+        if (!teamOccupiedSquares(color).isOccupiedAt(square))
             return;
 
-        const auto piece = pieceAt(square);
+        const auto piece = pieceAt(square, color);
 
-        Bitboard attacks;
-        bool promotion{false};
+        switch (color) {
+            case Color::White:
+                generateMoves<Color::White>(square, piece, moves);
+                break;
+            case Color::Black:
+                generateMoves<Color::Black>(square, piece, moves);
+                break;
+        }
+    }
+
+    template<Color color>
+    void Board::generateMoves(std::vector<Move> &moves) const {
+        generateMoves<color, PieceType::King>(moves);
+        generateMoves<color, PieceType::Queen>(moves);
+        generateMoves<color, PieceType::Rook>(moves);
+        generateMoves<color, PieceType::Bishop>(moves);
+        generateMoves<color, PieceType::Knight>(moves);
+        generateMoves<color, PieceType::Pawn>(moves);
+    }
+
+    template<Color color>
+    void Board::generateMoves(PieceType piece, std::vector<Move> &moves) const {
         switch (piece) {
             case PieceType::King:
-                attacks = kingAttacks(square);
-                // Castling
-                if (!squareThreatened(kings[static_cast<int>(playerTurn)],
-                                      oppositeTeam(playerTurn))) {
-                    if (playerTurn == Color::White) {
-                        if (!castlingRights[0][0] && !castlingRights[0][2]) {
-                            if (canCastleThrough(Square::F1, occupiedSquares) &&
-                                canCastleThrough(Square::G1, occupiedSquares)) {
-                                moves.emplace_back(square, Square::G1, Castling::WhiteKing);
-                            }
-                        }
-                        if (!castlingRights[0][0] && !castlingRights[0][1]) {
-                            if (canCastleThrough(Square::D1, occupiedSquares) &&
-                                canCastleThrough(Square::C1, occupiedSquares) &&
-                                !occupiedSquares.isOccupiedAt(Square::B1)) {
-                                moves.emplace_back(square, Square::C1, Castling::WhiteQueen);
-                            }
-                        }
-                    } else {
-                        if (!castlingRights[1][0] && !castlingRights[1][2]) {
-                            if (canCastleThrough(Square::F8, occupiedSquares) &&
-                                canCastleThrough(Square::G8, occupiedSquares)) {
-                                moves.emplace_back(square, Square::G8, Castling::BlackKing);
-                            }
-                        }
-                        if (!castlingRights[1][0] && !castlingRights[1][1]) {
-                            if (canCastleThrough(Square::D8, occupiedSquares) &&
-                                canCastleThrough(Square::C8, occupiedSquares) &&
-                                !occupiedSquares.isOccupiedAt(Square::B8)) {
-                                moves.emplace_back(square, Square::C8, Castling::BlackQueen);
-                            }
-                        }
-                    }
-                }
+                generateMoves<color, PieceType::King>(moves);
                 break;
             case PieceType::Queen:
-                attacks = queenAttacks(square, occupiedSquares);
+                generateMoves<color, PieceType::Queen>(moves);
                 break;
             case PieceType::Rook:
-                attacks = rookAttacks(square, occupiedSquares);
+                generateMoves<color, PieceType::Rook>(moves);
                 break;
             case PieceType::Bishop:
-                attacks = bishopAttacks(square, occupiedSquares);
+                generateMoves<color, PieceType::Bishop>(moves);
                 break;
             case PieceType::Knight:
-                attacks = knightAttacks(square);
+                generateMoves<color, PieceType::Knight>(moves);
                 break;
             case PieceType::Pawn:
-                if (enPassant != Square::None) {
-                    Square dropSquare;
-                    switch (color) {
-                        case Color::White:
-                            dropSquare = Bitboard::squareToThe(Direction::South, enPassant);
-                            if (square == Bitboard::squareToThe(Direction::SouthWest, enPassant) ||
-                                square == Bitboard::squareToThe(Direction::SouthEast, enPassant))
-                                moves.emplace_back(square, enPassant, true, dropSquare);
-                            break;
-                        case Color::Black:
-                            dropSquare = Bitboard::squareToThe(Direction::North, enPassant);
-                            if (square == Bitboard::squareToThe(Direction::NorthWest, enPassant) ||
-                                square == Bitboard::squareToThe(Direction::NorthEast, enPassant))
-                                moves.emplace_back(square, enPassant, true, dropSquare);
-                            break;
+                generateMoves<color, PieceType::Pawn>(moves);
+                break;
+        }
+    }
+
+    template<Color color>
+    void Board::generateMoves(Square square, PieceType piece, std::vector<Move> &moves) const {
+        const auto ourSquares = teamOccupiedSquares(color);
+        const auto enemySquares = teamOccupiedSquares(ColorTraits<color>::opponent);
+
+        switch (piece) {
+            case PieceType::King:
+                generateMoves<color, PieceType::King>(square, ourSquares, enemySquares, moves);
+                break;
+            case PieceType::Queen:
+                generateMoves<color, PieceType::Queen>(square, ourSquares, enemySquares, moves);
+                break;
+            case PieceType::Rook:
+                generateMoves<color, PieceType::Rook>(square, ourSquares, enemySquares, moves);
+                break;
+            case PieceType::Bishop:
+                generateMoves<color, PieceType::Bishop>(square, ourSquares, enemySquares, moves);
+                break;
+            case PieceType::Knight:
+                generateMoves<color, PieceType::Knight>(square, ourSquares, enemySquares, moves);
+                break;
+            case PieceType::Pawn:
+                generateMoves<color, PieceType::Pawn>(square, ourSquares, enemySquares, moves);
+                break;
+        }
+    }
+
+    template<Color color, PieceType piece>
+    void Board::generateMoves(std::vector<Move> &moves) const {
+        const auto ourSquares = teamOccupiedSquares(color);
+        const auto enemySquares = teamOccupiedSquares(ColorTraits<color>::opponent);
+
+        auto pieces = this->bitboards[ColorTraits<color>::index][static_cast<int>(piece)];
+        while (pieces)
+            generateMoves<color, piece>(pieces.popLowestSquare(), ourSquares, enemySquares, moves);
+    }
+
+    template<Color color, PieceType piece>
+    void Board::generateMoves(Square square, Bitboard ourSquares, Bitboard enemySquares,
+                              std::vector<Move> &moves) const {
+        using Traits = ColorTraits<color>;
+
+        const auto occupiedSquares = ourSquares | enemySquares;
+
+        Bitboard attacks;
+        bool promotion{false};
+
+        if constexpr (piece == PieceType::King) {
+            attacks = kingAttacks(square);
+
+            // Castling
+            const auto &rights = this->castlingRights[Traits::index];
+            const bool kingSide = !rights[0] && !rights[2];
+            const bool queenSide = !rights[0] && !rights[1];
+
+            if (kingSide || queenSide) {
+                const auto threatened = attackInfo().attacked[ColorTraits<Traits::opponent>::index];
+                const auto blocked = threatened | occupiedSquares;
+
+                if (!threatened.isOccupiedAt(this->kings[Traits::index])) {
+                    if (kingSide &&
+                        !blocked.isOccupiedAt(Traits::kingSideTransit) &&
+                        !blocked.isOccupiedAt(Traits::kingSideTarget)) {
+                        moves.emplace_back(square, Traits::kingSideTarget, Traits::kingSideCastle);
                     }
-                }
-                Bitboard startRank;
-                Bitboard promotionRank;
-                Direction attackDirection;
-                switch (color) {
-                    case Color::White:
-                        startRank = twoRank;
-                        promotionRank = sevenRank;
-                        attackDirection = Direction::North;
-                        break;
-                    case Color::Black:
-                        startRank = sevenRank;
-                        promotionRank = twoRank;
-                        attackDirection = Direction::South;
-                        break;
-                }
-                if (startRank.isOccupiedAt(square)) {
-                    Square firstSquare = Bitboard::squareToThe(attackDirection, square);
-                    Square secondSquare = Bitboard::squareToThe(attackDirection, firstSquare);
-                    if (!(occupiedSquares.isOccupiedAt(firstSquare) || occupiedSquares.isOccupiedAt(secondSquare))) {
-                        moves.emplace_back(square, secondSquare, firstSquare);
+                    if (queenSide &&
+                        !blocked.isOccupiedAt(Traits::queenSideTransit) &&
+                        !blocked.isOccupiedAt(Traits::queenSideTarget) &&
+                        !occupiedSquares.isOccupiedAt(Traits::queenSideRookTransit)) {
+                        moves.emplace_back(square, Traits::queenSideTarget, Traits::queenSideCastle);
                     }
                 }
-                if (promotionRank.isOccupiedAt(square))
-                    promotion = true;
-                attacks = pawnAttacks(square, occupiedSquares, color);
-                break;
-        }
+            }
 
-        if (!attacks)
-            return;
+        } else if constexpr (piece == PieceType::Queen) {
+            attacks = queenAttacks(square, occupiedSquares);
+
+        } else if constexpr (piece == PieceType::Rook) {
+            attacks = rookAttacks(square, occupiedSquares);
+
+        } else if constexpr (piece == PieceType::Bishop) {
+            attacks = bishopAttacks(square, occupiedSquares);
+
+        } else if constexpr (piece == PieceType::Knight) {
+            attacks = knightAttacks(square);
+
+        } else if constexpr (piece == PieceType::Pawn) {
+            if (enPassant != Square::None && pawnThreatens<color>(square).isOccupiedAt(enPassant)) {
+                const auto dropSquare = Bitboard(enPassant).shifted<Traits::backward>();
+                auto &move = moves.emplace_back(square, enPassant, true, Square(dropSquare.bitScanForward()));
+                move.dropPiece = PieceType::Pawn;
+            }
+
+            if (Traits::startRank.isOccupiedAt(square)) {
+                const Bitboard firstSquare = Bitboard(square).shifted<Traits::forward>();
+                const auto secondSquare = firstSquare.shifted<Traits::forward>();
+                if (!(firstSquare | secondSquare).isOverlappingWith(occupiedSquares)) {
+                    moves.emplace_back(square, Square(secondSquare.bitScanForward()),
+                                       Square(firstSquare.bitScanForward()));
+                }
+            }
+
+            promotion = Traits::promotionRank.isOccupiedAt(square);
+            attacks = pawnAttacks<color>(square, occupiedSquares);
+        }
 
         attacks &= ~ourSquares;
 
-        for (int j = 0; j < 64; ++j) {
-            auto to = Square(j);
-            if (!attacks.isOccupiedAt(to))
-                continue;
+        while (attacks) {
+            const auto to = attacks.popLowestSquare();
 
             moves.emplace_back(square, to, enemySquares.isOccupiedAt(to)
-                                           ? std::make_optional(pieceAt(to))
+                                           ? std::make_optional(pieceAt(to, Traits::opponent))
                                            : std::nullopt, promotion);
         }
     }
 
+    void Board::tacticalMoves(std::vector<Move> &moves) const {
+        PerfCounters::Scope scope(PerfCounters::Region::MoveGeneration);
+
+        switch (this->playerTurn) {
+            case Color::White:
+                generateTacticalMoves<Color::White>(moves);
+                break;
+            case Color::Black:
+                generateTacticalMoves<Color::Black>(moves);
+                break;
+        }
+    }
+
+    template<Color color>
+    void Board::generateTacticalMoves(std::vector<Move> &moves) const {
+        using Traits = ColorTraits<color>;
+
+        const auto &team = this->bitboards[Traits::index];
+        const auto ourSquares = teamOccupiedSquares(color);
+        const auto enemySquares = teamOccupiedSquares(Traits::opponent);
+        const auto occupiedSquares = ourSquares | enemySquares;
+
+        auto addCaptures = [&](Square from, Bitboard targets, bool promotion) {
+            while (targets) {
+                const auto to = targets.popLowestSquare();
+                moves.emplace_back(from, to, pieceAt(to, Traits::opponent), promotion);
+            }
+        };
+
+        for (auto pieces = team[static_cast<int>(PieceType::King)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            addCaptures(from, kingAttacks(from) & enemySquares, false);
+        }
+
+        for (auto pieces = team[static_cast<int>(PieceType::Queen)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            addCaptures(from, queenAttacks(from, occupiedSquares) & enemySquares, false);
+        }
+
+        for (auto pieces = team[static_cast<int>(PieceType::Rook)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            addCaptures(from, rookAttacks(from, occupiedSquares) & enemySquares, false);
+        }
+
+        for (auto pieces = team[static_cast<int>(PieceType::Bishop)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            addCaptures(from, bishopAttacks(from, occupiedSquares) & enemySquares, false);
+        }
+
+        for (auto pieces = team[static_cast<int>(PieceType::Knight)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            addCaptures(from, knightAttacks(from) & enemySquares, false);
+        }
+
+        for (auto pieces = team[static_cast<int>(PieceType::Pawn)]; pieces;) {
+            const auto from = pieces.popLowestSquare();
+            const bool promotion = Traits::promotionRank.isOccupiedAt(from);
+
+            if (enPassant != Square::None && pawnThreatens<color>(from).isOccupiedAt(enPassant)) {
+                const auto dropSquare = Bitboard(enPassant).shifted<Traits::backward>();
+                auto &move = moves.emplace_back(from, enPassant, true, Square(dropSquare.bitScanForward()));
+                move.dropPiece = PieceType::Pawn;
+            }
+
+            addCaptures(from, pawnThreatens<color>(from) & enemySquares, promotion);
+
+            if (promotion) {
+                const Bitboard target = Bitboard(from).shifted<Traits::forward>();
+                if (!target.isOverlappingWith(occupiedSquares))
+                    moves.emplace_back(from, Square(target.bitScanForward()), true);
+            }
+        }
+    }
+
     bool Board::isMovePseudoLegal(Move move) const {
         if (move.from == Square::None || move.to == Square::None)
             return false;
@@ -833,6 +1429,30 @@ namespace Chess {
         return occupiedSquares;
     }
 
+    Bitboard Board::pieces(Color color, PieceType piece) const {
+        return this->bitboards[static_cast<int>(color)][static_cast<int>(piece)];
+    }
+
+    Bitboard Board::attackersTo(Square square, Bitboard occupiedSquares) const {
+        const auto &white = this->bitboards[0];
+        const auto &black = this->bitboards[1];
+
+        auto both = [&](PieceType piece) {
+            return white[static_cast<int>(piece)] | black[static_cast<int>(piece)];
+        };
+
+        const auto queens = both(PieceType::Queen);
+
+        // A pawn of the opposite color on the square would threaten exactly
+        // the squares the attacking pawns stand on
+        return (pawnThreatens<Color::Black>(square) & white[static_cast<int>(PieceType::Pawn)]) |
+               (pawnThreatens<Color::White>(square) & black[static_cast<int>(PieceType::Pawn)]) |
+               (knightAttacks(square) & both(PieceType::Knight)) |
+               (kingAttacks(square) & both(PieceType::King)) |
+               (rookAttacks(square, occupiedSquares) & (both(PieceType::Rook) | queens)) |
+               (bishopAttacks(square, occupiedSquares) & (both(PieceType::Bishop) | queens));
+    }
+
     PieceType Board::pieceAt(Chess::Square square) const {
         for (auto team: this->bitboards) {
             for (int i = 0; i < team.size(); ++i) {
@@ -918,63 +1538,20 @@ namespace Chess {
         };
     }
 
-    Bitboard Board::pawnAttacks(Square square, Bitboard occupiedSquares, Color color) {
-        Direction attackDirection;
-        Bitboard startRank;
-        Square captureEast;
-        Square captureWest;
-
-        switch (color) {
-            case Color::White:
-                attackDirection = Direction::North;
-                startRank = twoRank;
-                captureEast = Bitboard::squareToThe(Direction::NorthEast, square);
-                captureWest = Bitboard::squareToThe(Direction::NorthWest, square);
-                break;
-
-            case Color::Black:
-                attackDirection = Direction::South;
-                startRank = sevenRank;
-                captureEast = Bitboard::squareToThe(Direction::SouthEast, square);
-                captureWest = Bitboard::squareToThe(Direction::SouthWest, square);
-                break;
-        }
-
-        Bitboard attacks;
-
-        auto attackMask = pawnAttackMasks[static_cast<int>(color)][static_cast<int>(square)];
-        if (!attackMask.isOverlappingWith(occupiedSquares)) {
-            attacks = attackMask;
+    template<Color color>
+    Bitboard Board::pawnAttacks(Square square, Bitboard occupiedSquares) {
+        const Bitboard pawn(square);
 
-        } else if (startRank.isOccupiedAt(square)) {
-            const auto nextSquare = Bitboard::squareToThe(attackDirection, square);
-            if (!occupiedSquares.isOccupiedAt(nextSquare))
-                attacks.setOccupancyAt(nextSquare);
-        }
-
-        if (captureEast != Square::None && occupiedSquares.isOccupiedAt(captureEast))
-            attacks.setOccupancyAt(captureEast);
-
-        if (captureWest != Square::None && occupiedSquares.isOccupiedAt(captureWest))
-            attacks.setOccupancyAt(captureWest);
-
-        return attacks;
+        return (pawn.shifted<ColorTraits<color>::forward>() & ~occupiedSquares) |
+               (pawnThreatens<color>(square) & occupiedSquares);
     }
 
-    Bitboard Board::pawnThreatens(Chess::Square square, Chess::Color color) {
-        Square captureWest = (color == Color::White) ? Bitboard::squareToThe(Direction::NorthWest, square)
-                                                     : Bitboard::squareToThe(Direction::SouthWest, square);
-        Square captureEast = (color == Color::White) ? Bitboard::squareToThe(Direction::NorthEast, square)
-                                                     : Bitboard::squareToThe(Direction::SouthEast, square);
+    template<Color color>
+    Bitboard Board::pawnThreatens(Chess::Square square) {
+        const Bitboard pawn(square);
 
-        Bitboard attacks;
-
-        if (captureWest != Square::None)
-            attacks.setOccupancyAt(captureWest);
-        if (captureEast != Square::None)
-            attacks.setOccupancyAt(captureEast);
-
-        return attacks;
+        return pawn.shifted<ColorTraits<color>::captureWest>() |
+               pawn.shifted<ColorTraits<color>::captureEast>();
     }
 
     Bitboard Board::slidingAttack(Square square, Direction direction,
@@ -1110,30 +1687,6 @@ namespace Chess {
         return attackMask;
     }
 
-    std::array<std::array<Bitboard, 64>, 2> Board::generatePawnAttackMasks() {
-        std::array<std::array<Bitboard, 64>, 2> attackMasks;
-
-        for (int i = 0; i < attackMasks.size(); ++i) {
-            for (int j = 0; j < attackMasks[i].size(); ++j) {
-                attackMasks[i][j] = generatePawnAttackMask(Square(j), Color(i));
-            }
-        }
-
-        return attackMasks;
-    }
-
-    Bitboard Board::generatePawnAttackMask(Square square, Color color) {
-        Direction attackDirection = (color == Color::White) ? Direction::North : Direction::South;
-
-        Bitboard attack;
-
-        auto attackSquare = Bitboard::squareToThe(attackDirection, square);
-        if (attackSquare != Square::None)
-            attack.setOccupancyAt(attackSquare);
-
-        return attack;
-    }
-
     std::ostream &operator<<(std::ostream &os, Color color) {
         static const char *const names[2]{"White", "Black"};
         return os << names[static_cast<int>(color)];
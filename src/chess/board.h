@@ -27,25 +27,109 @@ namespace Chess {
         Tied,
     };
 
+    /**
+     * Attack information for a single position. It is computed lazily by
+     * Board::attackInfo() and shared by move generation, legality testing and
+     * evaluation, so that no attack set has to be computed twice per position.
+     */
+    struct AttackInfo {
+        /**
+         * Squares attacked by each kind of piece, indexed by enums (Color and PieceType)
+         */
+        std::array<std::array<Bitboard, 6>, 2> attacks;
+
+        /**
+         * All squares attacked by a team, indexed by the Color enum
+         */
+        std::array<Bitboard, 2> attacked;
+
+        /**
+         * Enemy pieces giving check to the king of the side to move
+         */
+        Bitboard checkers;
+
+        /**
+         * Pieces of the side to move which are pinned to their own king
+         */
+        Bitboard pinned;
+
+        /**
+         * The king square and the squares adjacent to it, indexed by the Color enum
+         */
+        std::array<Bitboard, 2> kingZones;
+    };
+
+    /**
+     * A piece moved, captured or promoted by a move. A piece taken off the
+     * board goes to Square::None, and a piece put on the board comes from it.
+     */
+    struct DirtyPiece {
+        Color color{Color::White};
+        PieceType piece{PieceType::Pawn};
+        Square from{Square::None};
+        Square to{Square::None};
+    };
+
+    /**
+     * Every piece changed by one move, so that evaluations kept up to date
+     * incrementally can be updated without comparing positions. A move
+     * changes at most three pieces: a promotion with capture removes the
+     * pawn and the captured piece, and adds the new piece.
+     */
+    struct DirtyPieces {
+        int count{0};
+        std::array<DirtyPiece, 3> pieces;
+
+        void add(Color color, PieceType piece, Square from, Square to) {
+            pieces[count++] = {color, piece, from, to};
+        }
+    };
+
     class Board {
     public:
         explicit Board(const std::string &fen);
 
         Board();
 
-        Board(const Board &other)
-            : bitboards(other.bitboards),
-              enPassant(other.enPassant),
-              halfMoveCounter(other.halfMoveCounter),
-              fullMoveCounter(other.fullMoveCounter),
-              playerTurn(other.playerTurn) {
+        /**
+         * Copies the position, but not the moves made to reach it, so moves
+         * made before the copy cannot be undone on it.
+         */
+        Board(const Board &other) {
+            *this = other;
+        }
+
+        /**
+         * Like the copy constructor. The moves made are cleared rather than
+         * freed, so that a board reused for other positions does not allocate.
+         */
+        Board &operator=(const Board &other) {
+            if (this == &other)
+                return *this;
+
+            bitboards = other.bitboards;
             for (int i = 0; i < 3; ++i) {
                 castlingRights[0][i] = other.castlingRights[0][i];
                 castlingRights[1][i] = other.castlingRights[1][i];
             }
+            enPassant = other.enPassant;
+            halfMoveCounter = other.halfMoveCounter;
+            counterReset = other.counterReset;
+            previousResetValue = other.previousResetValue;
+            fullMoveCounter = other.fullMoveCounter;
             kings[0] = other.kings[0];
             kings[1] = other.kings[1];
-        };
+            movesMade.clear();
+            history.clear();
+            playerTurn = other.playerTurn;
+            key = other.key;
+            pawnKey = other.pawnKey;
+            pieceSquareScores = other.pieceSquareScores;
+            phase = other.phase;
+            attackInfoCache = other.attackInfoCache;
+            isAttackInfoValid = other.isAttackInfoValid;
+            return *this;
+        }
 
         void reset();
 
@@ -58,9 +142,86 @@ namespace Chess {
 
         void undoMove();
 
+        /**
+         * Pass the turn to the opponent without moving, as used by null move
+         * pruning. Not allowed while in check.
+         */
+        void performNullMove();
+
+        void undoNullMove();
+
         [[nodiscard]]
         Color turnToMove() const;
 
+        /**
+         * Zobrist hash of the current position, maintained incrementally as moves are made.
+         */
+        [[nodiscard]]
+        uint64_t hash() const;
+
+        /**
+         * Zobrist hash of the pawns only, which identifies the pawn structure.
+         */
+        [[nodiscard]]
+        uint64_t pawnHash() const;
+
+        /**
+         * Number of moves made on this board which can still be undone,
+         * counting null moves. Copies of a board start without any.
+         */
+        [[nodiscard]]
+        std::size_t historySize() const;
+
+        /**
+         * The hash of the position in which the move at the given index of the history was made.
+         */
+        [[nodiscard]]
+        uint64_t hashBefore(std::size_t index) const;
+
+        /**
+         * The pieces changed by the move at the given index of the history.
+         */
+        [[nodiscard]]
+        const DirtyPieces &dirtyPieces(std::size_t index) const;
+
+        [[nodiscard]]
+        Square kingSquare(Color color) const;
+
+        /**
+         * The castling rights left, one bit each: 1 for white kingside, 2 for
+         * white queenside, 4 for black kingside and 8 for black queenside.
+         */
+        [[nodiscard]]
+        int castlingMask() const;
+
+        /**
+         * The square a pawn can be captured on en passant, or Square::None.
+         */
+        [[nodiscard]]
+        Square enPassantSquare() const;
+
+        /**
+         * Plies played since the last capture or pawn move.
+         */
+        [[nodiscard]]
+        int halfMoveClock() const;
+
+        /**
+         * Material and piece-square score from white's point of view,
+         * interpolated between its middlegame and endgame values by the game
+         * phase. Maintained incrementally as moves are made.
+         */
+        [[nodiscard]]
+        int pieceSquareScore() const;
+
+        /**
+         * How much material is left, from Psqt::maxPhase with all pieces on the
+         * board down to 0 with only kings and pawns. Promotions can raise it
+         * beyond Psqt::maxPhase.
+         */
+        [[nodiscard]]
+        int gamePhase() const;
+
         void parseFen(const std::string &fen);
 
         [[nodiscard]]
@@ -72,6 +233,21 @@ namespace Chess {
         [[nodiscard]]
         bool isLegal() const;
 
+        /**
+         * Check whether a pseudo-legal move is legal. The attack information of the
+         * current position settles most moves directly; only king moves out of check,
+         * moves of pinned pieces while not in check and en passant captures are tested
+         * by performing them.
+         */
+        [[nodiscard]]
+        bool isLegal(Move move, const AttackInfo &info);
+
+        /**
+         * Whether the king of the player to move is attacked.
+         */
+        [[nodiscard]]
+        bool isInCheck() const;
+
         [[nodiscard]]
         bool squareThreatened(Square square, Color opponentColor) const;
 
@@ -81,6 +257,13 @@ namespace Chess {
         [[nodiscard]]
         bool canCastleThrough(Square square, Bitboard occupiedSquares) const;
 
+        /**
+         * Attack information for the current position. It is computed on first
+         * use and reused until the position changes.
+         */
+        [[nodiscard]]
+        const AttackInfo &attackInfo() const;
+
         [[nodiscard]]
         std::vector<Move> legalMoves();
 
@@ -90,6 +273,8 @@ namespace Chess {
         [[nodiscard]]
         std::vector<Move> pseudoLegalMoves() const;
 
+        void pseudoLegalMoves(std::vector<Move> &moves) const;
+
         [[nodiscard]]
         std::vector<Move> pseudoLegalMoves(PieceType piece) const;
 
@@ -105,12 +290,44 @@ namespace Chess {
 
         void pseudoLegalMoves(Square square, Color color, std::vector<Move> &moves) const;
 
+        /**
+         * Pseudo legal captures, including en passant, and promotions of the
+         * player to move. Used by quiescence search, which only looks at moves
+         * that change the material balance.
+         */
+        void tacticalMoves(std::vector<Move> &moves) const;
+
         [[nodiscard]]
         bool isMovePseudoLegal(Move move) const;
 
         [[nodiscard]]
         Bitboard teamOccupiedSquares(Color color) const;
 
+        [[nodiscard]]
+        Bitboard pieces(Color color, PieceType piece) const;
+
+        /**
+         * Pieces of both colors attacking the given square, with sliding
+         * attacks blocked by the given occupancy. Passing an occupancy with
+         * pieces removed reveals the attackers behind them.
+         */
+        [[nodiscard]]
+        Bitboard attackersTo(Square square, Bitboard occupiedSquares) const;
+
+        /**
+         * Squares attacked by a piece on the given square, with sliding
+         * attacks blocked by the given occupancy.
+         */
+        static Bitboard rookAttacks(Square square, Bitboard occupiedSquares);
+
+        static Bitboard bishopAttacks(Square square, Bitboard occupiedSquares);
+
+        static Bitboard knightAttacks(Square square);
+
+        static Bitboard kingAttacks(Square square);
+
+        static Bitboard queenAttacks(Square square, Bitboard occupiedSquares);
+
         [[nodiscard]]
         PieceType pieceAt(Square square) const;
 
@@ -139,28 +356,110 @@ namespace Chess {
 
         std::vector<Move> movesMade;
 
+        /**
+         * State which cannot be recovered from a move alone, saved before each
+         * move so that undoMove can restore it exactly.
+         */
+        struct History {
+            int castlingRights[2][3];
+            Square enPassant;
+            int counterReset;
+            int previousResetValue;
+            uint64_t key;
+            uint64_t pawnKey;
+            int pieceSquareScores;
+            int phase;
+            DirtyPieces dirtyPieces;
+        };
+
+        std::vector<History> history;
+
         /**
          * The color of the team whose turn to move it currently is
          */
         Color playerTurn{Color::White};
 
+        /**
+         * Zobrist hash of the current position
+         */
+        uint64_t key{0};
+
+        /**
+         * Zobrist hash of the pawns of both colors
+         */
+        uint64_t pawnKey{0};
+
+        /**
+         * Packed middlegame and endgame material and piece-square scores of
+         * white minus those of black, see Psqt::makeScore
+         */
+        int pieceSquareScores{0};
+
+        /**
+         * Sum of the phase weights of all pieces on the board
+         */
+        int phase{0};
+
+        /**
+         * Lazily computed attack information, see attackInfo()
+         */
+        mutable AttackInfo attackInfoCache;
+        mutable bool isAttackInfoValid{false};
+
+        void saveHistory();
+
+        [[nodiscard]]
+        uint64_t computeKey() const;
+
+        [[nodiscard]]
+        uint64_t computePawnKey() const;
+
+        [[nodiscard]]
+        int computePieceSquareScores() const;
+
+        [[nodiscard]]
+        int computePhase() const;
+
         PieceType removePieceAt(Square square);
 
         PieceType removePieceAt(Square square, Color color);
 
-        static Bitboard rookAttacks(Square square, Bitboard occupiedSquares);
+        template<Color color>
+        static Bitboard pawnAttacks(Square square, Bitboard occupiedSquares);
 
-        static Bitboard bishopAttacks(Square square, Bitboard occupiedSquares);
+        template<Color color>
+        static Bitboard pawnThreatens(Square square);
 
-        static Bitboard knightAttacks(Square square);
+        template<Color color>
+        bool squareThreatened(Square square) const;
 
-        static Bitboard kingAttacks(Square square);
+        template<Color color>
+        void computeAttackInfo(AttackInfo &info) const;
 
-        static Bitboard queenAttacks(Square square, Bitboard occupiedSquares);
+        template<Color color>
+        void computeTeamAttacks(std::array<Bitboard, 6> &attacks, Bitboard occupiedSquares) const;
+
+        template<Color color>
+        Bitboard pinnedPieces() const;
 
-        static Bitboard pawnAttacks(Square square, Bitboard occupiedSquares, Color color);
+        template<Color color>
+        void generateMoves(std::vector<Move> &moves) const;
 
-        static Bitboard pawnThreatens(Square square, Color color);
+        template<Color color>
+        void generateMoves(PieceType piece, std::vector<Move> &moves) const;
+
+        template<Color color>
+        void generateMoves(Square square, PieceType piece, std::vector<Move> &moves) const;
+
+        template<Color color, PieceType piece>
+        void generateMoves(std::vector<Move> &moves) const;
+
+        template<Color color, PieceType piece>
+        void generateMoves(Square square, Bitboard ourSquares, Bitboard enemySquares,
+                           std::vector<Move> &moves) const;
+
+        template<Color color>
+        void generateTacticalMoves(std::vector<Move> &moves) const;
 
         /**
          * Bitboards with attack rays for sliding pieces, indexed by enums (Direction and Square)
@@ -177,11 +476,6 @@ namespace Chess {
          */
         static const std::array<Bitboard, 64> kingAttackMasks;
 
-        /**
-         * Bitboards with attack masks for king pieces,indexed by the Color enum then the Square enum
-         */
-        static const std::array<std::array<Bitboard, 64>, 2> pawnAttackMasks;
-
         static Bitboard slidingAttack(Square square, Direction direction,
                                       Bitboard occupiedSquares);
 
@@ -196,9 +490,5 @@ namespace Chess {
         static std::array<Bitboard, 64> generateKingAttackMasks();
 
         static Bitboard generateKingAttackMask(Square square);
-
-        static std::array<std::array<Bitboard, 64>, 2> generatePawnAttackMasks();
-
-        static Bitboard generatePawnAttackMask(Square square, Color color);
     };
 }
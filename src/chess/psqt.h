@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Chess::Psqt {
+
+    /**
+     * Scores are kept as a middlegame and an endgame score packed into one
+     * integer, so that both are updated with a single addition. The endgame
+     * score lives in the upper 16 bits, and the middlegame score is added to
+     * it, so unpacking has to undo the borrow of a negative middlegame score.
+     */
+    constexpr int makeScore(int middlegame, int endgame) {
+        return static_cast<int>(static_cast<unsigned>(endgame) << 16) + middlegame;
+    }
+
+    constexpr int middlegameValue(int score) {
+        return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned>(score)));
+    }
+
+    constexpr int endgameValue(int score) {
+        return static_cast<int16_t>(static_cast<uint16_t>((static_cast<unsigned>(score) + 0x8000) >> 16));
+    }
+
+    /**
+     * Contribution of each kind of piece to the game phase, indexed by the
+     * PieceType enum. The phase is maxPhase with all pieces on the board,
+     * and 0 with only kings and pawns left.
+     */
+    inline constexpr int phaseWeights[6]{0, 4, 2, 1, 1, 0};
+
+    inline constexpr int maxPhase = 24;
+
+    /**
+     * Interpolate a packed score between its middlegame and endgame values by the game phase.
+     */
+    constexpr int taperedValue(int score, int phase) {
+        const int weight = (phase < maxPhase) ? phase : maxPhase;
+        return (middlegameValue(score) * weight + endgameValue(score) * (maxPhase - weight)) / maxPhase;
+    }
+
+    //@formatter:off
+    /**
+     * Material values, indexed by the PieceType enum. Kings are always on
+     * the board, so their value cancels out and is left out.
+     */
+    inline constexpr int pieceValues[6]{
+        0,
+        900,
+        500,
+        300,
+        300,
+        100,
+    };
+
+    /**
+     * Middlegame piece-square bonuses, indexed by enums (Color, PieceType and Square)
+     */
+    inline constexpr int positionWeights[2][6][64]{
+        {
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+            {
+                2, 3, 4, 3, 4, 3, 3, 2,
+                2, 3, 4, 4, 4, 4, 3, 2,
+                3, 4, 4, 4, 4, 4, 4, 3,
+                3, 3, 4, 4, 4, 4, 3, 3,
+                2, 3, 3, 4, 4, 3, 3, 2,
+                2, 2, 2, 3, 3, 2, 2, 2,
+                2, 2, 2, 2, 2, 2, 2, 2,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+            {
+                9, 9, 11, 10, 11, 9, 9, 9,
+                4, 6, 7, 9, 9, 7, 6, 4,
+                9, 10, 10, 11, 11, 10, 10, 9,
+                8, 8, 8, 9, 9, 8, 8, 8,
+                6, 6, 5, 6, 6, 5, 6, 6,
+                4, 5,  5,  5,  5,  5,  5,  4,
+                3, 4, 4, 6, 6, 4, 4, 3,
+                0, 0, 0,  0,  0,  0, 0, 0,
+            },
+            {
+                2, 3, 4, 4, 4, 4, 3, 2,
+                4, 7, 7, 7, 7, 7, 7, 4,
+                3, 5, 6, 6,  6,  6, 5, 3,
+                3, 5, 7, 7, 7, 7, 5, 3,
+                4, 5, 6, 8, 8, 6, 5, 4,
+                4, 5, 5, -2, -2, 5, 5, 4,
+                5, 5, 5, 3, 3, 5, 5, 5,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+            {
+                -2, 2,  7,  9,  9,  7,  2,  -2,
+                1,  4,  12, 13, 13, 12, 4,  1,
+                5,  11, 18, 19, 19, 18, 11, 5,
+                3, 10, 14, 14, 14, 14, 10, 3,
+                0, 5,  8,  9,  9,  8,  5,  0,
+                -3, 1,  3,  4,  4,  3,  1,  -3,
+                -5, -3, -1, 0,  0,  -1, -3, -5,
+                -7, -5, -4, -2, -2, -4, -5, -7,
+            },
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                7,  7,  13, 23, 26, 13, 7,  7,
+                -2, -2, 4, 12, 15, 4, -2, -2,
+                -3, -3, 2, 9, 11, 2, -3, -3,
+                -4, -4, 0, 6, 8,  0, -4, -4,
+                -4, -4, 0, 4,  6,  0, -4, -4,
+                -1, -1, 1,  5,  6,  1,  -1, -1,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+        },
+        {
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                2, 2, 2, 2, 2, 2, 2, 2,
+                2, 2, 2, 3, 3, 2, 2, 2,
+                2, 3, 3, 4, 4, 3, 3, 2,
+                3, 3, 4, 4, 4, 4, 3, 3,
+                3, 4, 4, 4, 4, 4, 4, 3,
+                2, 3, 4, 4, 4, 4, 3, 2,
+                2, 3, 4, 3, 4, 3, 3, 2,
+            },
+            {
+                0, 0, 0,  0,  0,  0, 0, 0,
+                3, 4, 4, 6, 6, 4, 4, 3,
+                4, 5,  5,  5,  5,  5,  5,  4,
+                6, 6, 5, 6, 6, 5, 6, 6,
+                8, 8, 8, 9, 9, 8, 8, 8,
+                9, 10, 10, 11, 11, 10, 10, 9,
+                4, 6, 7, 9, 9, 7, 6, 4,
+                9, 9, 11, 10, 11, 9, 9, 9,
+            },
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                5, 5, 5, 3, 3, 5, 5, 5,
+                4, 5, 5, -2, -2, 5, 5, 4,
+                4, 5, 6, 8, 8, 6, 5, 4,
+                3, 5, 7, 7, 7, 7, 5, 3,
+                3, 5, 6, 6,  6,  6, 5, 3,
+                4, 7, 7, 7, 7, 7, 7, 4,
+                2, 3, 4, 4, 4, 4, 3, 2,
+            },
+            {
+                -7, -5, -4, -2, -2, -4, -5, -7,
+                -5, -3, -1, 0,  0,  -1, -3, -5,
+                -3, 1,  3,  4,  4,  3,  1,  -3,
+                0, 5,  8,  9,  9,  8,  5,  0,
+                3, 10, 14, 14, 14, 14, 10, 3,
+                5,  11, 18, 19, 19, 18, 11, 5,
+                1,  4,  12, 13, 13, 12, 4,  1,
+                -2, 2,  7,  9,  9,  7,  2,  -2,
+            },
+            {
+                0, 0, 0, 0, 0, 0, 0, 0,
+                -1, -1, 1,  5,  6,  1,  -1, -1,
+                -4, -4, 0, 4,  6,  0, -4, -4,
+                -4, -4, 0, 6, 8,  0, -4, -4,
+                -3, -3, 2, 9, 11, 2, -3, -3,
+                -2, -2, 4, 12, 15, 4, -2, -2,
+                7,  7,  13, 23, 26, 13, 7,  7,
+                0, 0, 0, 0, 0, 0, 0, 0,
+            },
+        },
+    };
+
+    /**
+     * The king belongs in the center in the endgame, where there are too few
+     * pieces left to attack it. The table is symmetric, so it serves both colors.
+     */
+    inline constexpr int endgameKingWeights[64]{
+        -20, -12, -8, -6, -6, -8, -12, -20,
+        -12,  -4,  0,  2,  2,  0,  -4, -12,
+         -8,   0,  6,  8,  8,  6,   0,  -8,
+         -6,   2,  8, 12, 12,  8,   2,  -6,
+         -6,   2,  8, 12, 12,  8,   2,  -6,
+         -8,   0,  6,  8,  8,  6,   0,  -8,
+        -12,  -4,  0,  2,  2,  0,  -4, -12,
+        -20, -12, -8, -6, -6, -8, -12, -20,
+    };
+    //@formatter:on
+
+    /**
+     * Packed material and piece-square score of each piece on each square,
+     * indexed by enums (Color, PieceType and Square). Apart from the king,
+     * pieces are valued the same in the middlegame and the endgame.
+     */
+    constexpr std::array<std::array<std::array<int, 64>, 6>, 2> generateTable() {
+        std::array<std::array<std::array<int, 64>, 6>, 2> table{};
+
+        for (int color = 0; color < 2; ++color) {
+            for (int piece = 0; piece < 6; ++piece) {
+                for (int square = 0; square < 64; ++square) {
+                    const int middlegame = pieceValues[piece] + positionWeights[color][piece][square];
+                    const int endgame = (piece == 0) ? endgameKingWeights[square] : middlegame;
+                    table[color][piece][square] = makeScore(middlegame, endgame);
+                }
+            }
+        }
+
+        return table;
+    }
+
+    inline constexpr auto pieceSquareTable = generateTable();
+}
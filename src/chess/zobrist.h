@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Chess::Zobrist {
+
+    /**
+     * Random keys for Zobrist hashing of positions.
+     * See https://www.chessprogramming.org/Zobrist_Hashing
+     */
+    struct Keys {
+        /**
+         * Keys for a piece standing on a square, indexed by enums (Color, PieceType and Square)
+         */
+        uint64_t pieces[2][6][64];
+
+        /**
+         * Keys for each combination of the four castling rights (KQkq as bits 0-3)
+         */
+        uint64_t castling[16];
+
+        /**
+         * Keys for the file of the en passant square
+         */
+        uint64_t enPassant[8];
+
+        /**
+         * Key which is present when it is black's turn to move
+         */
+        uint64_t blackToMove;
+    };
+
+    /**
+     * Generate the keys at compile time with SplitMix64, so that hashes are the
+     * same on every run and every platform.
+     * See https://prng.di.unimi.it/splitmix64.c
+     */
+    constexpr Keys generateKeys() {
+        uint64_t state = 0x4465657047726565ULL;
+
+        auto next = [&state]() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+
+        Keys keys{};
+
+        for (auto &team: keys.pieces)
+            for (auto &piece: team)
+                for (auto &square: piece)
+                    square = next();
+
+        for (auto &key: keys.castling)
+            key = next();
+
+        for (auto &key: keys.enPassant)
+            key = next();
+
+        keys.blackToMove = next();
+
+        return keys;
+    }
+
+    inline constexpr Keys keys = generateKeys();
+}
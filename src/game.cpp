@@ -6,10 +6,15 @@
 #include <QStatusBar>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QFileDialog>
 #include <QtConcurrent>
 
+#include <cstdlib>
+#include <sstream>
+
 #include "config.h"
 #include "ai/brain.h"
+#include "trace/trace.h"
 
 // See https://stackoverflow.com/a/6852937/18713517
 #define QUOTE(x) #x
@@ -32,6 +37,8 @@ Game::Game(QWidget *parent)
 
     createActions();
 
+    connect(&this->aiWatcher, &QFutureWatcher<Chess::Move>::progressValueChanged, this, &Game::showSearchProgress);
+
     this->turnLabel = new QLabel();
     statusBar()->addPermanentWidget(this->turnLabel);
     updateTurn();
@@ -44,10 +51,7 @@ Game::Game(QWidget *parent)
 }
 
 Game::~Game() {
-    if (this->aiFuture.isRunning()) {
-        this->aiFuture.cancel();
-        this->aiFuture.waitForFinished();
-    }
+    cancelAiMove();
 }
 
 void Game::createActions() {
@@ -94,6 +98,61 @@ void Game::createActions() {
     this->zoomOutAction = viewMenu->addAction("Zoom &Out", this, &Game::zoomOut);
     this->zoomOutAction->setShortcut(QKeySequence::ZoomOut);
 
+    QMenu *engineMenu = menuBar()->addMenu("E&ngine");
+
+    this->hashSizeAction = engineMenu->addAction("&Hash Size...", this, &Game::setHashSize);
+    this->threadCountAction = engineMenu->addAction("&Threads...", this, &Game::setThreadCount);
+    this->moveTimeAction = engineMenu->addAction("&Move Time...", this, &Game::setMoveTime);
+    engineMenu->addAction("Analysis &Lines...", this, &Game::setMultiPv);
+
+    this->moveNowAction = engineMenu->addAction("Move N&ow", this, &Game::moveNow);
+    this->moveNowAction->setShortcut(Qt::CTRL | Qt::Key_M);
+
+    this->ponderAction = engineMenu->addAction("&Ponder");
+    this->ponderAction->setCheckable(true);
+    this->ponderAction->setChecked(true);
+    connect(this->ponderAction, &QAction::toggled, this, &Game::setPondering);
+
+    engineMenu->addSeparator();
+
+    engineMenu->addAction("Load &Network...", this, &Game::loadNetwork);
+
+    this->neuralEvaluationAction = engineMenu->addAction("N&eural Evaluation");
+    this->neuralEvaluationAction->setCheckable(true);
+    this->neuralEvaluationAction->setEnabled(Ai::isNetworkLoaded());
+    this->neuralEvaluationAction->setChecked(Ai::evaluator() == Ai::Evaluator::Neural);
+    connect(this->neuralEvaluationAction, &QAction::toggled, this, &Game::setNeuralEvaluation);
+
+    engineMenu->addSeparator();
+
+    engineMenu->addAction("Open &Book...", this, &Game::openBook);
+
+    this->closeBookAction = engineMenu->addAction("&Close Book", this, &Game::closeBook);
+    this->closeBookAction->setEnabled(Ai::isBookOpen());
+
+    auto *variedBookMovesAction = engineMenu->addAction("&Varied Book Moves");
+    variedBookMovesAction->setCheckable(true);
+    variedBookMovesAction->setChecked(Ai::bookSelection() == Ai::BookSelection::Weighted);
+    connect(variedBookMovesAction, &QAction::toggled, [](bool enabled) {
+        Ai::setBookSelection(enabled ? Ai::BookSelection::Weighted : Ai::BookSelection::Best);
+    });
+
+    engineMenu->addSeparator();
+
+    engineMenu->addAction("Set &Tablebase Directory...", this, &Game::setTablebaseDirectory);
+
+    engineMenu->addSeparator();
+
+    auto *sharedHashAction = engineMenu->addAction("Sha&red Hash Search", [] {
+        Ai::setParallelMode(Ai::ParallelMode::SharedHash);
+    });
+    sharedHashAction->setCheckable(true);
+
+    auto *splitPointAction = engineMenu->addAction("&Split Point Search", [] {
+        Ai::setParallelMode(Ai::ParallelMode::SplitPoint);
+    });
+    splitPointAction->setCheckable(true);
+
     QMenu *helpMenu = menuBar()->addMenu("&Help");
 
     helpMenu->addAction("&About", this, &Game::about);
@@ -102,6 +161,11 @@ void Game::createActions() {
     teamColorGroup->addAction(playAsWhiteAction);
     teamColorGroup->addAction(playAsBlackAction);
     playAsWhiteAction->setChecked(true);
+
+    auto *parallelModeGroup = new QActionGroup(this);
+    parallelModeGroup->addAction(sharedHashAction);
+    parallelModeGroup->addAction(splitPointAction);
+    (Ai::parallelMode() == Ai::ParallelMode::SplitPoint ? splitPointAction : sharedHashAction)->setChecked(true);
 }
 
 /**
@@ -160,6 +224,8 @@ void Game::squarePressed(Gui::Square &square) {
 }
 
 void Game::performMove(const Chess::Move &move) {
+    Trace::Span span("Perform move", "game");
+
     this->chessBoard.performMove(move);
 
     this->guiBoard->performMove(move);
@@ -170,15 +236,146 @@ void Game::performMove(const Chess::Move &move) {
 }
 
 void Game::performAiMove() {
-    if (this->aiFuture.isRunning()) {
-        this->aiFuture.cancel();
-        this->aiFuture.waitForFinished();
+    // On a ponder hit, the running search already is the search for this move
+    if (this->isPondering && this->aiFuture.isRunning() && this->chessBoard.hash() == this->ponderKey) {
+        this->isPondering = false;
+        Ai::ponderHit();
+        return;
     }
 
-    (this->aiFuture = QtConcurrent::run(Ai::selectMove, this->chessBoard))
-            .then([this](Chess::Move move) {
+    cancelAiMove();
+    startSearch(this->chessBoard, this->searchLimits);
+}
+
+/**
+ * Keep searching while the player thinks: the position after the reply the
+ * engine expects, or the current position if it expects none. The search
+ * fills the transposition table either way, and on a ponder hit it goes on
+ * as the search for the engine's next move.
+ */
+void Game::startPondering() {
+    cancelAiMove();
+
+    if (!this->ponderAction->isChecked())
+        return;
+
+    auto board = this->chessBoard;
+    if (this->expectedReply) {
+        board.performMove(*this->expectedReply);
+
+        // Nothing to search if the reply ends the game
+        if (board.state() != Chess::State::On)
+            board = this->chessBoard;
+    }
+
+    auto limits = this->searchLimits;
+    limits.ponder = true;
+
+    this->isPondering = true;
+    this->ponderKey = board.hash();
+    startSearch(board, limits);
+}
+
+void Game::startSearch(const Chess::Board &board, const Ai::SearchLimits &limits) {
+    Trace::instant(limits.ponder ? "Start pondering" : "Start search", "game");
+
+    // The continuation runs on the GUI thread, as it moves pieces and may start pondering
+    (this->aiFuture = QtConcurrent::run(Ai::selectMoveWithLimits, board, limits))
+            .then(this, [this](Chess::Move move) {
+                this->expectedReply = Ai::ponderMove();
+                showSearchStats();
                 Game::performMove(move);
             });
+    this->aiWatcher.setFuture(this->aiFuture);
+}
+
+/**
+ * Moves in coordinate notation, e.g. "e2e4 e7e5"
+ */
+static QString movesText(const std::vector<Chess::Move> &moves) {
+    std::ostringstream stream;
+    for (std::size_t i = 0; i < moves.size(); ++i)
+        stream << (i > 0 ? " " : "") << moves[i].from << moves[i].to;
+    return QString::fromStdString(stream.str());
+}
+
+static QString scoreText(const Ai::SearchLine &line) {
+    if (line.mate != 0)
+        return QString(line.mate > 0 ? "mate in %1" : "mated in %1").arg(std::abs(line.mate));
+
+    const auto pawns = QString::number(line.score / 100.0, 'f', 2);
+    return (line.score > 0) ? QString("+") + pawns : pawns;
+}
+
+void Game::showSearchProgress() {
+    // The lines of a ponder search are for a move the player has not made yet
+    if (this->isPondering)
+        return;
+
+    // The progress is only looked at after the fact, by which time a new search may have started
+    const auto progress = Ai::searchProgress();
+    if (progress.lines.empty() || progress.key != this->chessBoard.hash())
+        return;
+
+    QStringList lines;
+    for (const auto &line: progress.lines)
+        lines << QString("%1: %2").arg(scoreText(line), movesText(line.pv));
+
+    statusBar()->showMessage(QString("Depth %1, %2k nodes, %3").arg(progress.depth).arg(progress.nodes / 1000)
+                                     .arg(lines.front()));
+    statusBar()->setToolTip(lines.join('\n'));
+}
+
+void Game::moveNow() {
+    if (this->isPondering || !this->aiFuture.isRunning())
+        return;
+
+    // Until the search of this position completes its first iteration there
+    // is no move to play yet, and lines left by an earlier search do not count
+    const auto progress = Ai::searchProgress();
+    if (progress.lines.empty() || progress.key != this->chessBoard.hash()) {
+        statusBar()->showMessage("No move found yet", 2000);
+        return;
+    }
+
+    // The search ends as if its time were up, and its move is played as usual
+    Ai::stopSearch();
+}
+
+void Game::showSearchStats() {
+    const auto stats = Ai::searchStats();
+
+    // Book and tablebase moves are played without searching
+    if (stats.nodes == 0)
+        return;
+
+    auto message = QString("Depth %1").arg(stats.depth);
+    if (stats.hasDetails)
+        message += QString("/%1").arg(stats.selectiveDepth);
+    message += QString(", %1k nodes in %2 s, %3k nps, branching factor %4")
+            .arg(stats.nodes / 1000)
+            .arg(static_cast<double>(stats.time.count()) / 1000.0, 0, 'f', 1)
+            .arg(stats.nodesPerSecond() / 1000)
+            .arg(stats.branchingFactor(), 0, 'f', 1);
+    if (stats.hasDetails) {
+        message += QString(", first move cutoffs %1%, hash hits %2%, quiescence %3%")
+                .arg(qRound(100 * stats.firstMoveCutoffRate()))
+                .arg(qRound(100 * stats.hashHitRate()))
+                .arg(qRound(100 * stats.quiescenceRate()));
+    }
+    message += QString(", %1 MB").arg(stats.memory / (1024 * 1024));
+
+    statusBar()->showMessage(message);
+}
+
+void Game::cancelAiMove() {
+    if (this->aiFuture.isRunning()) {
+        // Waiting for the search to stop adds to the latency of whatever canceled it
+        Trace::Span span("Cancel search", "game");
+        this->aiFuture.cancel();
+        this->aiFuture.waitForFinished();
+    }
+    this->isPondering = false;
 }
 
 void Game::inputFen() {
@@ -196,10 +393,8 @@ void Game::inputFen() {
         return;
     }
 
-    if (this->aiFuture.isRunning()) {
-        this->aiFuture.cancel();
-        this->aiFuture.waitForFinished();
-    }
+    cancelAiMove();
+    this->expectedReply.reset();
 
     chessBoard.parseFen(inputStd);
 
@@ -243,10 +438,8 @@ void Game::setPlayerColor(Chess::Color color) {
  * and it is white's turn to move.
  */
 void Game::reset() {
-    if (this->aiFuture.isRunning()) {
-        this->aiFuture.cancel();
-        this->aiFuture.waitForFinished();
-    }
+    cancelAiMove();
+    this->expectedReply.reset();
 
     this->chessBoard.reset();
 
@@ -297,6 +490,160 @@ void Game::about() {
                        "<p>" TO_STRING(DESCRIPTION) "</p>");
 }
 
+void Game::setHashSize() {
+    bool ok;
+    const auto size = QInputDialog::getInt(this, "Hash Size", "Transposition table size (MB):",
+                                           static_cast<int>(Ai::hashSize()), 1, 65536, 1, &ok);
+    if (!ok)
+        return;
+
+    // The table cannot be reallocated under a running search, so restart it afterwards
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    Ai::setHashSize(size);
+    statusBar()->showMessage(QString("Hash size set to %1 MB").arg(Ai::hashSize()), 2000);
+
+    if (wasSearching)
+        updateTurn();
+}
+
+void Game::setThreadCount() {
+    bool ok;
+    const auto count = QInputDialog::getInt(this, "Threads", "Number of search threads:",
+                                            Ai::threadCount(), 1, 256, 1, &ok);
+    if (!ok)
+        return;
+
+    // Takes effect from the next search
+    Ai::setThreadCount(count);
+    statusBar()->showMessage(QString("Search threads set to %1").arg(Ai::threadCount()), 2000);
+}
+
+void Game::setMultiPv() {
+    bool ok;
+    const auto count = QInputDialog::getInt(this, "Analysis Lines", "Number of best moves to search:",
+                                            Ai::multiPv(), 1, 64, 1, &ok);
+    if (!ok)
+        return;
+
+    // Takes effect from the next search
+    Ai::setMultiPv(count);
+    statusBar()->showMessage(QString("Analysis lines set to %1").arg(Ai::multiPv()), 2000);
+}
+
+void Game::setMoveTime() {
+    bool ok;
+    const auto seconds = QInputDialog::getInt(this, "Move Time", "Time to think per move (seconds):",
+                                              static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(
+                                                      this->searchLimits.moveTime).count()),
+                                              1, 3600, 1, &ok);
+    if (!ok)
+        return;
+
+    // Takes effect from the next search
+    this->searchLimits.moveTime = std::chrono::seconds(seconds);
+    statusBar()->showMessage(QString("Move time set to %1 s").arg(seconds), 2000);
+}
+
+void Game::setPondering(bool enabled) {
+    if (!enabled) {
+        if (this->isPondering)
+            cancelAiMove();
+        return;
+    }
+
+    if (this->chessBoard.state() == Chess::State::On && this->chessBoard.turnToMove() == this->playerColor)
+        startPondering();
+}
+
+void Game::loadNetwork() {
+    const auto path = QFileDialog::getOpenFileName(this, "Load Network", QString(), "Networks (*.nnue);;All Files (*)");
+    if (path.isEmpty())
+        return;
+
+    // The network cannot be replaced under a running search, so restart it afterwards
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    if (Ai::loadNetwork(path.toStdString())) {
+        this->neuralEvaluationAction->setEnabled(true);
+        this->neuralEvaluationAction->setChecked(true);
+        Ai::setEvaluator(Ai::Evaluator::Neural);
+        statusBar()->showMessage("Network loaded", 2000);
+    } else {
+        QMessageBox::warning(this, "Load Network", QString("Could not load a network from %1").arg(path));
+    }
+
+    if (wasSearching)
+        updateTurn();
+}
+
+void Game::setNeuralEvaluation(bool enabled) {
+    const auto evaluator = enabled ? Ai::Evaluator::Neural : Ai::Evaluator::Classical;
+    if (Ai::evaluator() == evaluator)
+        return;
+
+    // The evaluator cannot be changed under a running search, so restart it afterwards
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    Ai::setEvaluator(evaluator);
+
+    if (wasSearching)
+        updateTurn();
+}
+
+void Game::openBook() {
+    const auto path = QFileDialog::getOpenFileName(this, "Open Book", QString(), "Polyglot Books (*.bin);;All Files (*)");
+    if (path.isEmpty())
+        return;
+
+    // The book cannot be replaced under a running search, so restart it afterwards
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    if (Ai::openBook(path.toStdString()))
+        statusBar()->showMessage("Book opened", 2000);
+    else
+        QMessageBox::warning(this, "Open Book",
+                             QString("Could not open %1 as a Polyglot book.").arg(path));
+    this->closeBookAction->setEnabled(Ai::isBookOpen());
+
+    if (wasSearching)
+        updateTurn();
+}
+
+void Game::closeBook() {
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    Ai::closeBook();
+    this->closeBookAction->setEnabled(false);
+
+    if (wasSearching)
+        updateTurn();
+}
+
+void Game::setTablebaseDirectory() {
+    const auto path = QFileDialog::getExistingDirectory(this, "Set Tablebase Directory");
+    if (path.isEmpty())
+        return;
+
+    // The tablebases cannot be replaced under a running search, so restart it afterwards
+    const bool wasSearching = this->aiFuture.isRunning();
+    cancelAiMove();
+
+    if (const int count = Ai::setTablebasePath(path.toStdString()); count > 0)
+        statusBar()->showMessage(QString("%1 tablebases found").arg(count), 2000);
+    else
+        QMessageBox::warning(this, "Set Tablebase Directory",
+                             QString("No Syzygy tablebases were found in %1").arg(path));
+
+    if (wasSearching)
+        updateTurn();
+}
+
 void Game::updateTurn() {
     if (auto state = this->chessBoard.state(); state != Chess::State::On) {
         switch (state) {
@@ -327,4 +674,6 @@ void Game::updateTurn() {
 
     if (this->chessBoard.turnToMove() != this->playerColor)
         performAiMove();
+    else
+        startPondering();
 }
@@ -5,8 +5,12 @@
 #include <QLabel>
 #include <QAction>
 #include <QFuture>
+#include <QFutureWatcher>
+
+#include <optional>
 
 #include "chess/board.h"
+#include "ai/searchlimits.h"
 #include "gui/board.h"
 #include "gui/square.h"
 
@@ -42,6 +46,36 @@ private slots:
 
     void about();
 
+    void setHashSize();
+
+    void setThreadCount();
+
+    void setMultiPv();
+
+    void setMoveTime();
+
+    void setPondering(bool enabled);
+
+    void loadNetwork();
+
+    void setNeuralEvaluation(bool enabled);
+
+    void openBook();
+
+    void closeBook();
+
+    void setTablebaseDirectory();
+
+    /**
+     * Show the best line of the running search, whenever it completes an iteration
+     */
+    void showSearchProgress();
+
+    /**
+     * Play the best move the running search has found so far
+     */
+    void moveNow();
+
 private:
     const static int SQUARE_SIZE_ADJUST_OFFSET = 40;
 
@@ -60,17 +94,53 @@ private:
     QAction *flipBoardAction{nullptr};
     QAction *zoomInAction{nullptr};
     QAction *zoomOutAction{nullptr};
+    QAction *hashSizeAction{nullptr};
+    QAction *threadCountAction{nullptr};
+    QAction *moveTimeAction{nullptr};
+    QAction *ponderAction{nullptr};
+    QAction *neuralEvaluationAction{nullptr};
+    QAction *closeBookAction{nullptr};
+    QAction *moveNowAction{nullptr};
 
     Gui::Square *highlightedSquare{nullptr};
 
     QFuture<Chess::Move> aiFuture;
 
+    /**
+     * Watches aiFuture for the progress of the search
+     */
+    QFutureWatcher<Chess::Move> aiWatcher;
+
+    Ai::SearchLimits searchLimits{.moveTime = std::chrono::seconds(15)};
+
+    /**
+     * The reply the engine expected to its last move
+     */
+    std::optional<Chess::Move> expectedReply;
+
+    /**
+     * Whether aiFuture is a ponder search, and the hash of the position it searches
+     */
+    bool isPondering{false};
+    uint64_t ponderKey{0};
+
     void createActions();
 
     void performMove(const Chess::Move &move);
 
     void performAiMove();
 
+    void startPondering();
+
+    void startSearch(const Chess::Board &board, const Ai::SearchLimits &limits);
+
+    void cancelAiMove();
+
+    /**
+     * Summarise the last search in the status bar
+     */
+    void showSearchStats();
+
     void updateTurn();
 
     void setPlayerColor(Chess::Color color);
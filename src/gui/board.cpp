@@ -1,4 +1,5 @@
 #include "board.h"
+#include "../trace/trace.h"
 
 #include <QGridLayout>
 
@@ -99,6 +100,8 @@ namespace Gui {
     }
 
     void Board::set(const Chess::Board &chessBoard) {
+        Trace::Span span("Set board", "gui");
+
         const auto whiteOccupiedSquares = chessBoard.teamOccupiedSquares(Chess::Color::White);
         const auto blackOccupiedSquares = chessBoard.teamOccupiedSquares(Chess::Color::Black);
 
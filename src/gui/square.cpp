@@ -1,5 +1,6 @@
 #include "square.h"
 #include "board.h"
+#include "../trace/trace.h"
 
 #include <QPainter>
 
@@ -17,6 +18,8 @@ namespace Gui {
     }
 
     void Square::paintEvent(QPaintEvent *event) {
+        Trace::Span span("Paint square", "gui", {"square", 8 * this->rank + this->file});
+
         QWidget::paintEvent(event);
 
         auto contentsRect = this->contentsRect();
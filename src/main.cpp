@@ -1,10 +1,51 @@
 #include <QApplication>
+#include <QFileInfo>
+#include <QtConcurrent>
 
 #include "game.h"
+#include "ai/brain.h"
+#include "trace/trace.h"
+#include "trace/perfcounters.h"
+
+#include <cstdlib>
+#include <iostream>
 
 int main(int argc, char *argv[]) {
     QApplication application(argc, argv);
 
+    // Record a trace of the search and the GUI to the file given in
+    // DEEPGREEN_TRACE, written at exit, see Trace
+    if (const char *tracePath = std::getenv("DEEPGREEN_TRACE"); tracePath && Trace::start(tracePath)) {
+        Trace::setThreadName("GUI");
+        std::atexit([] { Trace::stop(); });
+    }
+
+    // Built with DEEPGREEN_PERF_COUNTERS, report the counters of the whole session at exit
+    if constexpr (PerfCounters::isEnabled)
+        std::atexit([] { PerfCounters::report(std::cerr); });
+
+    // Evaluate with a neural network if one is given, or found next to the executable
+    const auto networkPath = (argc > 1) ? QString(argv[1])
+                                        : QApplication::applicationDirPath() + "/deepgreen.nnue";
+    if (QFileInfo::exists(networkPath) && Ai::loadNetwork(networkPath.toStdString()))
+        Ai::setEvaluator(Ai::Evaluator::Neural);
+
+    // Play the opening from a book if one is found next to the executable
+    if (const auto bookPath = QApplication::applicationDirPath() + "/book.bin"; QFileInfo::exists(bookPath))
+        Ai::openBook(bookPath.toStdString());
+
+    // Endgame bitbases are read from the bitbases directory next to the
+    // executable, and the missing ones generated in the background so as not
+    // to hold up the window; the engine plays without them until then
+    auto bitbasesLoaded = QtConcurrent::run(Ai::loadBitbases,
+                                            (QApplication::applicationDirPath() + "/bitbases").toStdString());
+
+    // Quitting only waits for the bitbase being generated, not for the rest
+    QObject::connect(&application, &QCoreApplication::aboutToQuit, [&bitbasesLoaded] { bitbasesLoaded.cancel(); });
+
+    // Syzygy tablebases are probed from the syzygy directory next to the executable
+    Ai::setTablebasePath((QApplication::applicationDirPath() + "/syzygy").toStdString());
+
     Game game;
     game.show();
 
@@ -0,0 +1,249 @@
+#include "perfcounters.h"
+
+#include <array>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#if defined(DEEPGREEN_PERF_COUNTERS) && defined(__linux__)
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+namespace PerfCounters {
+
+    using Counts = std::array<std::array<uint64_t, counterCount>, regionCount>;
+
+    static constexpr const char *regionNames[regionCount]{
+            "Move generation",
+            "Make/unmake",
+            "Evaluation",
+            "Hash probing",
+    };
+
+    /**
+     * Counts of threads which have exited, and the threads still counting
+     */
+    static Counts exitedCounts{};
+    static std::array<bool, counterCount> availableCounters{};
+    static std::mutex countsMutex;
+
+#if defined(DEEPGREEN_PERF_COUNTERS) && defined(__linux__)
+
+    /**
+     * The counters of one thread, opened as a group the first time it enters
+     * a region, so that they are read together and scheduled together.
+     */
+    struct ThreadCounters {
+        ThreadCounters();
+
+        ~ThreadCounters();
+
+        ThreadCounters(const ThreadCounters &) = delete;
+
+        ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+        /**
+         * Read the counters, adding what they counted since the last read to the innermost region
+         */
+        void update();
+
+        int leaderFd{-1};
+        std::array<int, counterCount> fds{};
+
+        /**
+         * Where each counter is in a read of the group, or -1 if it is not available
+         */
+        std::array<int, counterCount> positions{};
+        int openCount{0};
+
+        std::array<uint64_t, counterCount> lastValues{};
+
+        /**
+         * Regions entered and not left yet, the innermost last
+         */
+        std::vector<Region> regions;
+
+        Counts counts{};
+    };
+
+    static std::vector<ThreadCounters *> threads;
+
+    static perf_event_attr counterAttributes(Counter counter) {
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+
+        const auto cacheMiss = [](uint64_t cache) {
+            return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        };
+
+        switch (counter) {
+            case Counter::Instructions:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case Counter::Cycles:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case Counter::BranchMisses:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case Counter::L1DataMisses:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = cacheMiss(PERF_COUNT_HW_CACHE_L1D);
+                break;
+            case Counter::LastLevelMisses:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = cacheMiss(PERF_COUNT_HW_CACHE_LL);
+                break;
+        }
+        return attributes;
+    }
+
+    ThreadCounters::ThreadCounters() {
+        this->regions.reserve(16);
+
+        // The first counter which opens leads the group, and the others join
+        // it; those the machine lacks are left out
+        for (int i = 0; i < counterCount; ++i) {
+            auto attributes = counterAttributes(Counter(i));
+            this->fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, this->leaderFd, 0));
+            this->positions[i] = (this->fds[i] >= 0) ? this->openCount++ : -1;
+            if (this->leaderFd < 0)
+                this->leaderFd = this->fds[i];
+        }
+
+        std::scoped_lock lock(countsMutex);
+        for (int i = 0; i < counterCount; ++i)
+            availableCounters[i] = availableCounters[i] || this->positions[i] >= 0;
+        threads.push_back(this);
+    }
+
+    ThreadCounters::~ThreadCounters() {
+        for (const auto fd: this->fds) {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        std::scoped_lock lock(countsMutex);
+        for (int region = 0; region < regionCount; ++region) {
+            for (int counter = 0; counter < counterCount; ++counter)
+                exitedCounts[region][counter] += this->counts[region][counter];
+        }
+        std::erase(threads, this);
+    }
+
+    void ThreadCounters::update() {
+        if (this->leaderFd < 0)
+            return;
+
+        // The number of counters, followed by their values
+        std::array<uint64_t, counterCount + 1> buffer{};
+        if (read(this->leaderFd, buffer.data(), sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t)))
+            return;
+
+        for (int i = 0; i < counterCount; ++i) {
+            if (this->positions[i] < 0)
+                continue;
+
+            const auto value = buffer[1 + this->positions[i]];
+            if (!this->regions.empty())
+                this->counts[static_cast<int>(this->regions.back())][i] += value - this->lastValues[i];
+            this->lastValues[i] = value;
+        }
+    }
+
+    static ThreadCounters &threadCounters() {
+        static thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    void enter(Region region) {
+        auto &counters = threadCounters();
+        counters.update();
+        counters.regions.push_back(region);
+    }
+
+    void leave() {
+        auto &counters = threadCounters();
+        counters.update();
+        counters.regions.pop_back();
+    }
+
+#else
+
+    struct ThreadCounters {
+        Counts counts{};
+    };
+
+    static std::vector<ThreadCounters *> threads;
+
+    void enter(Region) {}
+
+    void leave() {}
+
+#endif
+
+    bool isAvailable(Counter counter) {
+        std::scoped_lock lock(countsMutex);
+        return availableCounters[static_cast<int>(counter)];
+    }
+
+    uint64_t count(Region region, Counter counter) {
+        std::scoped_lock lock(countsMutex);
+        auto total = exitedCounts[static_cast<int>(region)][static_cast<int>(counter)];
+        for (const auto *thread: threads)
+            total += thread->counts[static_cast<int>(region)][static_cast<int>(counter)];
+        return total;
+    }
+
+    void reset() {
+        std::scoped_lock lock(countsMutex);
+        exitedCounts = {};
+        for (auto *thread: threads)
+            thread->counts = {};
+    }
+
+    void report(std::ostream &stream) {
+        if constexpr (!isEnabled) {
+            stream << "Performance counters are not built in, see DEEPGREEN_PERF_COUNTERS\n";
+            return;
+        }
+
+        static constexpr const char *counterNames[counterCount]{
+                "instructions", "cycles", "branch misses", "L1D misses", "LLC misses",
+        };
+
+        stream << std::setw(16) << "";
+        for (const auto *name: counterNames)
+            stream << std::setw(15) << name;
+        stream << std::setw(8) << "IPC" << '\n';
+
+        for (int region = 0; region < regionCount; ++region) {
+            stream << std::setw(16) << std::left << regionNames[region] << std::right;
+            for (int counter = 0; counter < counterCount; ++counter) {
+                if (isAvailable(Counter(counter)))
+                    stream << std::setw(15) << count(Region(region), Counter(counter));
+                else
+                    stream << std::setw(15) << "-";
+            }
+
+            const auto instructions = count(Region(region), Counter::Instructions);
+            const auto cycles = count(Region(region), Counter::Cycles);
+            if (cycles > 0)
+                stream << std::setw(8) << std::fixed << std::setprecision(2)
+                       << static_cast<double>(instructions) / static_cast<double>(cycles);
+            else
+                stream << std::setw(8) << "-";
+            stream << '\n';
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Hardware performance counters of the engine hot paths, read through
+ * Linux perf_event_open: instructions, cycles, branch misses and level 1
+ * data and last level cache misses. They tell whether a change is bound by
+ * memory or by branches, which nodes per second alone does not.
+ *
+ * <p> Only built with the DEEPGREEN_PERF_COUNTERS CMake option on Linux;
+ * otherwise regions compile to nothing. Every thread counts itself, with
+ * its counters read at each boundary of a region, and time in nested
+ * regions is only counted for the innermost one. Each read is a system
+ * call, so instrumented builds run much slower, but only the user space
+ * part of the work is counted.
+ * See https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+ */
+namespace PerfCounters {
+
+#if defined(DEEPGREEN_PERF_COUNTERS) && defined(__linux__)
+    inline constexpr bool isEnabled = true;
+#else
+    inline constexpr bool isEnabled = false;
+#endif
+
+    enum class Region {
+        MoveGeneration,
+        MakeUnmake,
+        Evaluation,
+        HashProbe,
+    };
+
+    inline constexpr int regionCount = 4;
+
+    enum class Counter {
+        Instructions,
+        Cycles,
+        BranchMisses,
+        L1DataMisses,
+        LastLevelMisses,
+    };
+
+    inline constexpr int counterCount = 5;
+
+    void enter(Region region);
+
+    void leave();
+
+    /**
+     * Counts its lifetime to a region.
+     */
+    class Scope {
+    public:
+        explicit Scope(Region region) {
+            if constexpr (isEnabled)
+                enter(region);
+        }
+
+        ~Scope() {
+            if constexpr (isEnabled)
+                leave();
+        }
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    /**
+     * Whether the counter could be opened, as virtual machines and
+     * processors may lack some. Known once a region has been entered.
+     */
+    [[nodiscard]]
+    bool isAvailable(Counter counter);
+
+    /**
+     * The count of all threads in a region since the last reset. Must not be
+     * called while threads are counting, e.g. while a search is running.
+     */
+    [[nodiscard]]
+    uint64_t count(Region region, Counter counter);
+
+    /**
+     * Must not be called while threads are counting.
+     */
+    void reset();
+
+    /**
+     * Write a table of the counts and the instructions per cycle of every
+     * region. Must not be called while threads are counting.
+     */
+    void report(std::ostream &stream);
+}
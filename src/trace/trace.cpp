@@ -0,0 +1,244 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+    struct Event {
+        const char *name;
+        const char *category;
+        Argument arguments[2];
+
+        /**
+         * Nanoseconds since the recording started, and the duration, or -1 for an instant event
+         */
+        int64_t start;
+        int64_t duration;
+    };
+
+    /**
+     * The events of one thread. Only that thread writes them, and it
+     * publishes each event by counting it with release ordering, so stop
+     * reads complete events without locking.
+     */
+    struct Ring {
+        static constexpr uint64_t capacity = 1 << 16;
+
+        std::vector<Event> events = std::vector<Event>(capacity);
+        std::atomic<uint64_t> written{0};
+
+        int threadId{0};
+        std::atomic<const char *> threadName{nullptr};
+
+        /**
+         * Cleared when its thread exits, so that a new thread takes it over
+         * instead of making another, since search threads come and go
+         */
+        std::atomic<bool> isInUse{true};
+    };
+
+    static std::atomic<bool> recording{false};
+    static std::chrono::steady_clock::time_point origin;
+    static std::string outputPath;
+
+    /**
+     * Rings are only made and taken over under the mutex, once per thread
+     */
+    static std::vector<std::unique_ptr<Ring>> rings;
+    static std::mutex ringsMutex;
+
+    /**
+     * Gives the ring of a thread back when the thread exits.
+     */
+    struct RingHandle {
+        Ring *ring{nullptr};
+
+        ~RingHandle() {
+            if (this->ring)
+                this->ring->isInUse.store(false, std::memory_order_release);
+        }
+    };
+
+    static thread_local RingHandle ringHandle;
+    static thread_local const char *currentThreadName{nullptr};
+
+    static Ring &threadRing() {
+        if (ringHandle.ring)
+            return *ringHandle.ring;
+
+        std::scoped_lock lock(ringsMutex);
+        for (auto &ring: rings) {
+            if (!ring->isInUse.load(std::memory_order_acquire)) {
+                ring->isInUse.store(true, std::memory_order_relaxed);
+                ringHandle.ring = ring.get();
+                break;
+            }
+        }
+
+        if (!ringHandle.ring) {
+            rings.push_back(std::make_unique<Ring>());
+            rings.back()->threadId = static_cast<int>(rings.size());
+            ringHandle.ring = rings.back().get();
+        }
+
+        ringHandle.ring->threadName.store(currentThreadName, std::memory_order_relaxed);
+        return *ringHandle.ring;
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    static void record(const Event &event) {
+        auto &ring = threadRing();
+        const auto index = ring.written.load(std::memory_order_relaxed);
+        ring.events[index % Ring::capacity] = event;
+        ring.written.store(index + 1, std::memory_order_release);
+    }
+
+    static void writeString(std::ostream &stream, const char *string) {
+        stream << '"';
+        for (; *string; ++string) {
+            const auto character = static_cast<unsigned char>(*string);
+            if (character == '"' || character == '\\')
+                stream << '\\' << *string;
+            else if (character < 0x20)
+                stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(character)
+                       << std::dec << std::setfill(' ');
+            else
+                stream << *string;
+        }
+        stream << '"';
+    }
+
+    /**
+     * Write microseconds, the unit of the format
+     */
+    static void writeTime(std::ostream &stream, int64_t nanoseconds) {
+        stream << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000
+               << std::setfill(' ');
+    }
+
+    static void writeEvent(std::ostream &stream, const Event &event, int threadId) {
+        stream << "{\"name\":";
+        writeString(stream, event.name);
+        stream << ",\"cat\":";
+        writeString(stream, event.category);
+
+        if (event.duration < 0) {
+            stream << R"(,"ph":"i","s":"t")";
+        } else {
+            stream << R"(,"ph":"X","dur":)";
+            writeTime(stream, event.duration);
+        }
+
+        stream << ",\"ts\":";
+        writeTime(stream, event.start);
+        stream << R"(,"pid":1,"tid":)" << threadId << ",\"args\":{";
+
+        bool isFirst = true;
+        for (const auto &argument: event.arguments) {
+            if (!argument.name)
+                continue;
+            if (!isFirst)
+                stream << ',';
+            isFirst = false;
+            writeString(stream, argument.name);
+            stream << ':' << argument.value;
+        }
+        stream << "}}";
+    }
+
+    bool start(const std::string &path) {
+        std::scoped_lock lock(ringsMutex);
+        if (recording.load(std::memory_order_relaxed))
+            return false;
+
+        outputPath = path;
+        for (auto &ring: rings)
+            ring->written.store(0, std::memory_order_relaxed);
+
+        origin = std::chrono::steady_clock::now();
+        recording.store(true, std::memory_order_release);
+        return true;
+    }
+
+    bool stop() {
+        std::scoped_lock lock(ringsMutex);
+        if (!recording.exchange(false, std::memory_order_acq_rel))
+            return false;
+
+        std::ofstream file(outputPath);
+        if (!file)
+            return false;
+
+        file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+        bool isFirst = true;
+        const auto separate = [&] {
+            file << (isFirst ? "\n" : ",\n");
+            isFirst = false;
+        };
+
+        for (const auto &ring: rings) {
+            const auto written = ring->written.load(std::memory_order_acquire);
+            if (written == 0)
+                continue;
+
+            if (const auto *threadName = ring->threadName.load(std::memory_order_relaxed)) {
+                separate();
+                file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << ring->threadId << R"(,"args":{"name":)";
+                writeString(file, threadName);
+                file << "}}";
+            }
+
+            // A full ring holds the latest events. A thread still recording
+            // may be overwriting the oldest of them, so those are left out.
+            static constexpr uint64_t overwriteMargin = 64;
+            const auto first = (written > Ring::capacity) ? written - Ring::capacity + overwriteMargin : 0;
+            for (auto i = first; i < written; ++i) {
+                separate();
+                writeEvent(file, ring->events[i % Ring::capacity], ring->threadId);
+            }
+        }
+
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    bool isRecording() {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char *name) {
+        currentThreadName = name;
+        if (ringHandle.ring)
+            ringHandle.ring->threadName.store(name, std::memory_order_relaxed);
+    }
+
+    void instant(const char *name, const char *category, Argument first, Argument second) {
+        if (recording.load(std::memory_order_acquire))
+            record({name, category, {first, second}, now(), -1});
+    }
+
+    Span::Span(const char *name, const char *category, Argument first, Argument second)
+            : name(name),
+              category(category),
+              arguments{first, second},
+              start(recording.load(std::memory_order_acquire) ? now() : -1) {}
+
+    Span::~Span() {
+        if (this->start >= 0 && recording.load(std::memory_order_acquire))
+            record({this->name, this->category, {this->arguments[0], this->arguments[1]}, this->start,
+                    now() - this->start});
+    }
+
+    void Span::setResult(Argument result) {
+        this->arguments[1] = result;
+    }
+}
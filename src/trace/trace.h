@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Opt-in recorder of timed events, written as Chrome trace event JSON which
+ * chrome://tracing and https://ui.perfetto.dev show as a timeline. While
+ * recording is off, which is the default, an event costs a single relaxed
+ * atomic load. While it is on, every thread records into its own ring
+ * buffer without locking, keeping the latest events if it overflows.
+ * See https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+namespace Trace {
+
+    /**
+     * A named integer attached to an event. Names must be string literals,
+     * or otherwise outlive the recording.
+     */
+    struct Argument {
+        const char *name{nullptr};
+        int64_t value{0};
+    };
+
+    /**
+     * Start recording, to be written to a file by stop. Returns false if
+     * recording already.
+     */
+    bool start(const std::string &path);
+
+    /**
+     * Stop recording and write what was recorded to the file given to
+     * start. Threads still recording may lose their last events, so it
+     * should be called once the traced work is done, such as at exit.
+     * Returns false if not recording or the file cannot be written.
+     */
+    bool stop();
+
+    [[nodiscard]]
+    bool isRecording();
+
+    /**
+     * Name the calling thread in the timeline. The name must outlive the recording.
+     */
+    void setThreadName(const char *name);
+
+    /**
+     * Record a point in time, such as a decision.
+     */
+    void instant(const char *name, const char *category, Argument first = {}, Argument second = {});
+
+    /**
+     * Records the time from its construction to its destruction.
+     */
+    class Span {
+    public:
+        Span(const char *name, const char *category, Argument first = {}, Argument second = {});
+
+        ~Span();
+
+        Span(const Span &) = delete;
+
+        Span &operator=(const Span &) = delete;
+
+        /**
+         * Replace the second argument, for results only known at the end of the span.
+         */
+        void setResult(Argument result);
+
+    private:
+        const char *name;
+        const char *category;
+        Argument arguments[2];
+
+        /**
+         * Nanoseconds since the recording started, or -1 if it was not recording
+         */
+        int64_t start;
+    };
+}
@@ -0,0 +1,66 @@
+/**
+ * Generates endgame bitbases and writes them to a directory, from which
+ * the engine loads them at startup. The bitbases an endgame can turn into
+ * are generated and written as well.
+ *
+ * Usage: DeepGreenBitbases <directory> [threads] [endgames...]
+ */
+
+#include "../src/ai/bitbase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory> [threads] [endgames...]\n";
+        return 1;
+    }
+
+    const std::string directory = argv[1];
+    const int threads = (argc > 2) ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    std::vector<std::string> endgames;
+    for (int i = 3; i < argc; ++i)
+        endgames.emplace_back(argv[i]);
+    if (endgames.empty())
+        endgames = {"KPK", "KRK", "KQK"};
+
+    std::filesystem::create_directories(directory);
+
+    // Bitbases written before are reused for the endgames depending on them
+    Ai::Bitbases::load(directory);
+
+    for (const auto &endgame: endgames) {
+        const auto name = Ai::Bitbases::canonicalName(endgame);
+        if (name.empty()) {
+            std::cerr << endgame << ": not an endgame of at most " << Ai::Bitbases::maxPieces << " pieces\n";
+            return 1;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (!Ai::Bitbases::generate(name, std::max(threads, 1))) {
+            std::cerr << name << ": generation failed\n";
+            return 1;
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::setw(6) << name << ": " << std::fixed << std::setprecision(1) << elapsed.count() << " s\n";
+    }
+
+    for (const auto &name: Ai::Bitbases::available()) {
+        if (!Ai::Bitbases::save(name, directory)) {
+            std::cerr << name << ": could not be written to " << directory << '\n';
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+/**
+ * Checks a set of Syzygy tablebases before the engine is trusted with them:
+ * the results of every position of KQvK, KRvK and KPvK against the
+ * bitbases, which the engine computes itself, the distances to zero of
+ * those positions against the ones of the positions after each move, and
+ * the results of well known KRPvKR positions. Prints the mismatches found
+ * and fails if there are any, or if a table is missing.
+ *
+ * Usage: DeepGreenSyzygyCheck <syzygy directory> [threads]
+ */
+
+#include "../src/ai/bitbase.h"
+#include "../src/ai/syzygy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Ai::Bitbases::Result;
+using Ai::Syzygy::Wdl;
+
+/**
+ * Mismatches printed per check, the rest are only counted.
+ */
+static constexpr int reportedMismatches = 10;
+
+static Result bitbaseResult(Wdl wdl) {
+    switch (wdl) {
+        case Wdl::Win:
+        case Wdl::CursedWin:
+            return Result::Win;
+        case Wdl::Loss:
+        case Wdl::BlessedLoss:
+            return Result::Loss;
+        case Wdl::Draw:
+            break;
+    }
+    return Result::Draw;
+}
+
+static const char *resultName(Result result) {
+    switch (result) {
+        case Result::Win:
+            return "win";
+        case Result::Loss:
+            return "loss";
+        case Result::Draw:
+            break;
+    }
+    return "draw";
+}
+
+/**
+ * The distance to zero of a position worked out from the positions after
+ * each of its moves, as the tables should have it, or nothing if one of
+ * them cannot be probed.
+ */
+static std::optional<int> dtzFromMoves(Chess::Board &board) {
+    const auto moves = board.legalMoves();
+    if (moves.empty())
+        return board.isInCheck() ? -1 : 0;
+
+    const auto wdl = Ai::Syzygy::probeWdl(board);
+    if (!wdl)
+        return std::nullopt;
+    if (*wdl == Wdl::Draw)
+        return 0;
+
+    const bool isWin = *wdl == Wdl::Win || *wdl == Wdl::CursedWin;
+
+    // The winning side takes the quickest way to a winning zeroing move,
+    // and the losing side the slowest to any zeroing move
+    std::optional<int> best;
+    for (const auto &move: moves) {
+        board.performMove(move);
+
+        std::optional<int> distance;
+        if (board.halfMoveClock() == 0) {
+            const auto childWdl = Ai::Syzygy::probeWdl(board);
+            if (!childWdl) {
+                board.undoMove();
+                return std::nullopt;
+            }
+            if (!isWin || bitbaseResult(*childWdl) == Result::Loss)
+                distance = 1;
+        } else {
+            const auto childDtz = Ai::Syzygy::probeDtz(board);
+            if (!childDtz) {
+                board.undoMove();
+                return std::nullopt;
+            }
+            if (isWin && *childDtz < 0)
+                distance = 1 - *childDtz;
+            else if (!isWin && *childDtz > 0)
+                distance = 1 + *childDtz;
+        }
+
+        board.undoMove();
+
+        if (distance)
+            best = best ? (isWin ? std::min(*best, *distance) : std::max(*best, *distance)) : *distance;
+    }
+
+    if (!best)
+        return std::nullopt;
+    return isWin ? *best : -*best;
+}
+
+/**
+ * Placement of a piece on a board given as FEN rows, a1 being square 0.
+ */
+static void place(std::string &squares, int square, char piece) {
+    squares[static_cast<std::size_t>(square)] = piece;
+}
+
+static std::string fen(const std::string &squares, bool isWhiteToMove) {
+    std::string result;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            const char piece = squares[static_cast<std::size_t>(8 * rank + file)];
+            if (piece == ' ') {
+                ++empty;
+                continue;
+            }
+            if (empty)
+                result += static_cast<char>('0' + empty);
+            empty = 0;
+            result += piece;
+        }
+        if (empty)
+            result += static_cast<char>('0' + empty);
+        if (rank)
+            result += '/';
+    }
+    return result + (isWhiteToMove ? " w - - 0 1" : " b - - 0 1");
+}
+
+/**
+ * Compare every position of a three piece endgame, where white has the
+ * king and the given piece, returning the number of mismatches.
+ */
+static long checkEndgame(const std::string &name, char piece) {
+    long positions = 0;
+    long wdlMismatches = 0;
+    long dtzMismatches = 0;
+    long wdlUnprobed = 0;
+    long dtzUnprobed = 0;
+
+    for (int whiteKing = 0; whiteKing < 64; ++whiteKing) {
+        for (int blackKing = 0; blackKing < 64; ++blackKing) {
+            for (int square = 0; square < 64; ++square) {
+                if (whiteKing == blackKing || square == whiteKing || square == blackKing)
+                    continue;
+                if (piece == 'P' && (square < 8 || square >= 56))
+                    continue;
+
+                std::string squares(64, ' ');
+                place(squares, whiteKing, 'K');
+                place(squares, blackKing, 'k');
+                place(squares, square, piece);
+
+                for (const bool isWhiteToMove: {true, false}) {
+                    Chess::Board board{fen(squares, isWhiteToMove)};
+                    if (!board.isLegal())
+                        continue;
+                    ++positions;
+
+                    const auto known = Ai::Bitbases::probe(board);
+                    const auto wdl = Ai::Syzygy::probeWdl(board);
+                    if (!known || !wdl)
+                        ++wdlUnprobed;
+                    else if (bitbaseResult(*wdl) != *known && ++wdlMismatches <= reportedMismatches)
+                        std::cout << "  " << board.generateFen() << ": tables say " << resultName(bitbaseResult(*wdl))
+                                  << ", bitbases say " << resultName(*known) << '\n';
+
+                    const auto dtz = Ai::Syzygy::probeDtz(board);
+                    const auto expectedDtz = dtzFromMoves(board);
+                    if (!dtz || !expectedDtz)
+                        ++dtzUnprobed;
+                    else if (*dtz != *expectedDtz && ++dtzMismatches <= reportedMismatches)
+                        std::cout << "  " << board.generateFen() << ": DTZ " << *dtz << ", after the moves "
+                                  << *expectedDtz << '\n';
+                }
+            }
+        }
+    }
+
+    std::cout << name << ": " << positions << " positions, " << wdlMismatches << " WDL mismatches ("
+              << wdlUnprobed << " not probed), " << dtzMismatches << " DTZ mismatches (" << dtzUnprobed
+              << " not probed)\n";
+    return wdlMismatches + dtzMismatches + wdlUnprobed + dtzUnprobed;
+}
+
+/**
+ * KRPvKR positions whose results are known from endgame theory.
+ */
+struct KnownPosition {
+    const char *name;
+    const char *fen;
+    Wdl wdl;
+};
+
+static constexpr KnownPosition knownPositions[]{
+    {"Lucena", "1K1k4/1P6/8/8/8/8/r7/2R5 w - - 0 1", Wdl::Win},
+    {"Philidor", "4k3/R7/1r6/4PK2/8/8/8/8 b - - 0 1", Wdl::Draw},
+};
+
+static long checkKnownPositions() {
+    long mismatches = 0;
+
+    for (const auto &known: knownPositions) {
+        Chess::Board board{std::string(known.fen)};
+        const auto wdl = Ai::Syzygy::probeWdl(board);
+        const auto dtz = Ai::Syzygy::probeDtz(board);
+
+        // The distance to zero must agree with the result
+        const bool isConsistent = wdl && dtz && (*dtz > 0) == (bitbaseResult(*wdl) == Result::Win) &&
+                                  (*dtz == 0) == (*wdl == Wdl::Draw);
+        const bool isCorrect = wdl && *wdl == known.wdl && isConsistent;
+        if (!isCorrect)
+            ++mismatches;
+
+        std::cout << "KRPvKR " << known.name << ": ";
+        if (wdl && dtz)
+            std::cout << resultName(bitbaseResult(*wdl)) << ", DTZ " << *dtz;
+        else
+            std::cout << "not probed";
+        std::cout << (isCorrect ? "" : ", expected ") << (isCorrect ? "" : resultName(bitbaseResult(known.wdl)))
+                  << '\n';
+    }
+
+    return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <syzygy directory> [threads]\n";
+        return 1;
+    }
+
+    const int threads = (argc > 2) ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    const int endgames = Ai::Syzygy::setPath(argv[1]);
+    std::cout << endgames << " endgames found, the largest with " << Ai::Syzygy::largest() << " pieces\n";
+
+    for (const auto *name: {"KQK", "KRK", "KPK"}) {
+        if (!Ai::Bitbases::generate(name, std::max(threads, 1))) {
+            std::cerr << name << ": generation failed\n";
+            return 1;
+        }
+    }
+
+    long mismatches = 0;
+    mismatches += checkEndgame("KQvK", 'Q');
+    mismatches += checkEndgame("KRvK", 'R');
+    mismatches += checkEndgame("KPvK", 'P');
+    mismatches += checkKnownPositions();
+
+    std::cout << (mismatches ? "FAILED" : "OK") << '\n';
+    return mismatches ? 1 : 0;
+}